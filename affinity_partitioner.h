@@ -0,0 +1,40 @@
+#ifndef TP__AFFINITY_PARTITIONER_H_
+#define TP__AFFINITY_PARTITIONER_H_
+
+#include <atomic>
+#include <vector>
+
+// Remembers which worker ran each sub-range of a ThreadPool::forEach call so that
+// the next call over a range of the same size sends every sub-range back to the
+// same worker. Keep one instance alive across the iterations of an iterative job.
+class AffinityPartitioner {
+ public:
+  AffinityPartitioner() = default;
+
+  AffinityPartitioner(const AffinityPartitioner&) = delete;
+  AffinityPartitioner& operator=(const AffinityPartitioner&) = delete;
+
+  // Used by the pool: keeps one slot per chunk, resetting them when the chunk count changes.
+  void resize(std::size_t chunks_count);
+  std::atomic_size_t& slot(std::size_t chunk);
+
+ private:
+  std::vector<std::atomic_size_t> slots;
+};
+
+void AffinityPartitioner::resize(std::size_t chunks_count) {
+  if (slots.size() == chunks_count) {
+    return;
+  }
+
+  slots = std::vector<std::atomic_size_t>(chunks_count);
+  for (auto i = 0; i < chunks_count; ++i) {
+    slots[i].store(i, std::memory_order_relaxed);
+  }
+}
+
+std::atomic_size_t& AffinityPartitioner::slot(std::size_t chunk) {
+  return slots[chunk];
+}
+
+#endif //TP__AFFINITY_PARTITIONER_H_
@@ -0,0 +1,155 @@
+#ifndef TP__BLOCKED_RANGE_H_
+#define TP__BLOCKED_RANGE_H_
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+// A Dimensions-dimensional box of indices [begin(d), end(d)) for ThreadPool::parallelFor.
+// The range is split in halves along its longest dimension until every dimension is at most
+// its grain, so the grains set the tile size handed to the loop body; pick them so that one
+// tile of the data touched by the body fits in cache.
+template<std::size_t Dimensions>
+class BlockedRange {
+ public:
+  static constexpr std::size_t default_grain = Dimensions == 1 ? 4096 : Dimensions == 2 ? 64 : 16;
+
+  BlockedRange(const std::array<std::size_t, Dimensions>& begins,
+               const std::array<std::size_t, Dimensions>& ends,
+               const std::array<std::size_t, Dimensions>& grains);
+
+  std::size_t begin(std::size_t dimension) const;
+  std::size_t end(std::size_t dimension) const;
+  std::size_t size(std::size_t dimension) const;
+  bool empty() const;
+
+  bool divisible() const;
+  // Keeps the lower half of the longest divisible dimension and returns the upper half.
+  BlockedRange split();
+ private:
+  std::array<std::size_t, Dimensions> begins;
+  std::array<std::size_t, Dimensions> ends;
+  std::array<std::size_t, Dimensions> grains;
+};
+
+class BlockedRange2D : public BlockedRange<2> {
+ public:
+  BlockedRange2D(std::size_t rows_begin, std::size_t rows_end,
+                 std::size_t cols_begin, std::size_t cols_end,
+                 std::size_t rows_grain = default_grain, std::size_t cols_grain = default_grain);
+
+  BlockedRange2D(const BlockedRange<2>& range);
+
+  std::size_t rowsBegin() const { return begin(0); }
+  std::size_t rowsEnd() const { return end(0); }
+  std::size_t colsBegin() const { return begin(1); }
+  std::size_t colsEnd() const { return end(1); }
+};
+
+class BlockedRange3D : public BlockedRange<3> {
+ public:
+  BlockedRange3D(std::size_t pages_begin, std::size_t pages_end,
+                 std::size_t rows_begin, std::size_t rows_end,
+                 std::size_t cols_begin, std::size_t cols_end,
+                 std::size_t pages_grain = default_grain,
+                 std::size_t rows_grain = default_grain,
+                 std::size_t cols_grain = default_grain);
+
+  BlockedRange3D(const BlockedRange<3>& range);
+
+  std::size_t pagesBegin() const { return begin(0); }
+  std::size_t pagesEnd() const { return end(0); }
+  std::size_t rowsBegin() const { return begin(1); }
+  std::size_t rowsEnd() const { return end(1); }
+  std::size_t colsBegin() const { return begin(2); }
+  std::size_t colsEnd() const { return end(2); }
+};
+
+template<std::size_t Dimensions>
+BlockedRange<Dimensions>::BlockedRange(const std::array<std::size_t, Dimensions>& begins,
+                                       const std::array<std::size_t, Dimensions>& ends,
+                                       const std::array<std::size_t, Dimensions>& grains)
+    : begins(begins), ends(ends), grains(grains) {
+  for (auto d = 0; d < Dimensions; ++d) {
+    assert(begins[d] <= ends[d] && "The supplied range begin cannot be after its end");
+    assert(grains[d] > 0 && "The supplied grain value cannot be 0");
+  }
+}
+
+template<std::size_t Dimensions>
+std::size_t BlockedRange<Dimensions>::begin(std::size_t dimension) const {
+  return begins[dimension];
+}
+
+template<std::size_t Dimensions>
+std::size_t BlockedRange<Dimensions>::end(std::size_t dimension) const {
+  return ends[dimension];
+}
+
+template<std::size_t Dimensions>
+std::size_t BlockedRange<Dimensions>::size(std::size_t dimension) const {
+  return ends[dimension] - begins[dimension];
+}
+
+template<std::size_t Dimensions>
+bool BlockedRange<Dimensions>::empty() const {
+  for (auto d = 0; d < Dimensions; ++d) {
+    if (begins[d] == ends[d]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<std::size_t Dimensions>
+bool BlockedRange<Dimensions>::divisible() const {
+  for (auto d = 0; d < Dimensions; ++d) {
+    if (size(d) > grains[d]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<std::size_t Dimensions>
+BlockedRange<Dimensions> BlockedRange<Dimensions>::split() {
+  assert(divisible() && "Can't split a range that is not divisible.");
+
+  std::size_t longest = Dimensions;
+  for (auto d = 0; d < Dimensions; ++d) {
+    if (size(d) > grains[d] && (longest == Dimensions || size(d) > size(longest))) {
+      longest = d;
+    }
+  }
+
+  BlockedRange upper = *this;
+  const auto middle = begins[longest] + size(longest) / 2;
+  ends[longest] = middle;
+  upper.begins[longest] = middle;
+  return upper;
+}
+
+BlockedRange2D::BlockedRange2D(std::size_t rows_begin, std::size_t rows_end,
+                               std::size_t cols_begin, std::size_t cols_end,
+                               std::size_t rows_grain, std::size_t cols_grain)
+    : BlockedRange<2>({rows_begin, cols_begin}, {rows_end, cols_end}, {rows_grain, cols_grain}) {
+}
+
+BlockedRange2D::BlockedRange2D(const BlockedRange<2>& range) : BlockedRange<2>(range) {
+}
+
+BlockedRange3D::BlockedRange3D(std::size_t pages_begin, std::size_t pages_end,
+                               std::size_t rows_begin, std::size_t rows_end,
+                               std::size_t cols_begin, std::size_t cols_end,
+                               std::size_t pages_grain,
+                               std::size_t rows_grain,
+                               std::size_t cols_grain)
+    : BlockedRange<3>({pages_begin, rows_begin, cols_begin},
+                      {pages_end, rows_end, cols_end},
+                      {pages_grain, rows_grain, cols_grain}) {
+}
+
+BlockedRange3D::BlockedRange3D(const BlockedRange<3>& range) : BlockedRange<3>(range) {
+}
+
+#endif //TP__BLOCKED_RANGE_H_
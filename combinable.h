@@ -0,0 +1,113 @@
+#ifndef TP__COMBINABLE_H_
+#define TP__COMBINABLE_H_
+
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "thread_pool.h"
+
+// Thread-local accumulators for reductions inside pool tasks. Every worker gets its own slot,
+// indexed by its worker id and padded to a cache line, so local() needs neither a lock nor an
+// atomic read-modify-write. Threads outside the pool (e.g. a caller running a task itself)
+// fall back to a slot looked up under a mutex.
+//
+// combine() and forEach() must only be called once the tasks using local() have finished.
+template<typename T, typename Pool = ThreadPool>
+class Combinable {
+ public:
+  static constexpr std::size_t cache_line_size = 64;
+
+  explicit Combinable(Pool& pool, T initial_value = T());
+
+  Combinable(const Combinable&) = delete;
+  Combinable& operator=(const Combinable&) = delete;
+
+  // The calling thread's value, set to the initial value on first use.
+  T& local();
+
+  // Folds the values of all threads that called local(); returns the initial value if none did.
+  template<typename BinaryOperation>
+  T combine(BinaryOperation op) const;
+
+  template<typename UnaryFunction>
+  void forEach(UnaryFunction f) const;
+
+  void clear();
+ private:
+  struct alignas(cache_line_size) Slot {
+    T value;
+    bool used = false;
+  };
+
+  Pool& pool;
+  T initial_value;
+  std::vector<Slot> slots;
+
+  mutable std::mutex external_slots_mutex;
+  std::unordered_map<std::thread::id, Slot> external_slots;
+};
+
+template<typename T, typename Pool>
+Combinable<T, Pool>::Combinable(Pool& pool, T initial_value)
+    : pool(pool), initial_value(std::move(initial_value)), slots(pool.workerCount()) {
+}
+
+template<typename T, typename Pool>
+T& Combinable<T, Pool>::local() {
+  const auto worker_index = pool.currentWorkerIndex();
+
+  Slot* slot;
+  if (worker_index < slots.size()) {
+    slot = &slots[worker_index];
+  } else {
+    std::lock_guard<std::mutex> lock(external_slots_mutex);
+    slot = &external_slots[std::this_thread::get_id()];
+  }
+
+  if (!slot->used) {
+    slot->value = initial_value;
+    slot->used = true;
+  }
+  return slot->value;
+}
+
+template<typename T, typename Pool>
+template<typename BinaryOperation>
+T Combinable<T, Pool>::combine(BinaryOperation op) const {
+  bool first = true;
+  T result = initial_value;
+  forEach([&first, &result, &op](const T& value) {
+    result = first ? value : op(result, value);
+    first = false;
+  });
+  return result;
+}
+
+template<typename T, typename Pool>
+template<typename UnaryFunction>
+void Combinable<T, Pool>::forEach(UnaryFunction f) const {
+  for (const auto& slot : slots) {
+    if (slot.used) {
+      f(slot.value);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(external_slots_mutex);
+  for (const auto& p : external_slots) {
+    f(p.second.value);
+  }
+}
+
+template<typename T, typename Pool>
+void Combinable<T, Pool>::clear() {
+  for (auto& slot : slots) {
+    slot.used = false;
+  }
+
+  std::lock_guard<std::mutex> lock(external_slots_mutex);
+  external_slots.clear();
+}
+
+#endif //TP__COMBINABLE_H_
@@ -0,0 +1,8 @@
+#ifndef TP__FILTER_MODE_H_
+#define TP__FILTER_MODE_H_
+
+enum class FilterMode {
+  SERIAL_IN_ORDER, SERIAL_OUT_OF_ORDER, PARALLEL
+};
+
+#endif //TP__FILTER_MODE_H_
@@ -0,0 +1,43 @@
+#ifndef TP__IDLE_POLICY_H_
+#define TP__IDLE_POLICY_H_
+
+#include <atomic>
+#include <thread>
+
+// Idle policies decide what a worker does once its own queue is empty and stealing failed.
+// acquire(task) retries the worker's own queue and then stealing.
+
+class BlockingIdle {
+ public:
+  template<typename Queue, typename Task, typename Acquire>
+  bool idle(Queue& queue, Task& task, const std::atomic_bool& terminated, const Acquire& acquire);
+};
+
+template<typename Queue, typename Task, typename Acquire>
+bool BlockingIdle::idle(Queue& queue, Task& task, const std::atomic_bool& terminated, const Acquire&) {
+  return queue.waitAndPopIf(task,
+                            [&terminated](bool empty) { return terminated || !empty; },
+                            [&terminated](bool empty) { return !empty && !terminated; });
+}
+
+// Yields and retries up to SpinCount times before blocking, trading CPU time for wake-up latency.
+template<std::size_t SpinCount = 64>
+class SpinningIdle {
+ public:
+  template<typename Queue, typename Task, typename Acquire>
+  bool idle(Queue& queue, Task& task, const std::atomic_bool& terminated, const Acquire& acquire);
+};
+
+template<std::size_t SpinCount>
+template<typename Queue, typename Task, typename Acquire>
+bool SpinningIdle<SpinCount>::idle(Queue& queue, Task& task, const std::atomic_bool& terminated, const Acquire& acquire) {
+  for (auto i = 0; i < SpinCount && !terminated; ++i) {
+    std::this_thread::yield();
+    if (acquire(task)) {
+      return true;
+    }
+  }
+  return BlockingIdle().idle(queue, task, terminated, acquire);
+}
+
+#endif //TP__IDLE_POLICY_H_
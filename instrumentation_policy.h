@@ -0,0 +1,72 @@
+#ifndef TP__INSTRUMENTATION_POLICY_H_
+#define TP__INSTRUMENTATION_POLICY_H_
+
+#include <mutex>
+#include <memory>
+#include <condition_variable>
+
+#include "profiler.h"
+#include "profiled_mutex.h"
+
+// Instrumentation policies decide which mutex and condition variable the queues use
+// and receive the wait and task timings measured by the workers.
+
+class NoInstrumentation {
+ public:
+  using MutexType = std::mutex;
+  using CondVarType = std::condition_variable;
+
+  struct TimePoint {};
+
+  MutexType createMutex() const { return MutexType(); }
+
+  TimePoint now() const { return {}; }
+  void logWait(TimePoint) const {}
+  void logTask(TimePoint) const {}
+};
+
+class ProfiledInstrumentation {
+ public:
+  using MutexType = ProfiledMutex;
+  using CondVarType = std::condition_variable_any;
+  using TimePoint = Profiler::TimePoint;
+
+  ProfiledInstrumentation(std::shared_ptr<Profiler> profiler = nullptr);
+
+  MutexType createMutex() const;
+
+  TimePoint now() const;
+  void logWait(TimePoint start) const;
+  void logTask(TimePoint start) const;
+ private:
+  std::shared_ptr<Profiler> profiler;
+};
+
+ProfiledInstrumentation::ProfiledInstrumentation(std::shared_ptr<Profiler> profiler_ptr)
+    : profiler(std::move(profiler_ptr)) {
+}
+
+ProfiledInstrumentation::MutexType ProfiledInstrumentation::createMutex() const {
+  return MutexType(profiler);
+}
+
+ProfiledInstrumentation::TimePoint ProfiledInstrumentation::now() const {
+  return Profiler::Clock::now();
+}
+
+void ProfiledInstrumentation::logWait(TimePoint start) const {
+  if (profiler) {
+    profiler->logWait(Profiler::Clock::now() - start);
+  }
+}
+
+void ProfiledInstrumentation::logTask(TimePoint start) const {
+  if (profiler) {
+    profiler->logTask(Profiler::Clock::now() - start);
+  }
+}
+
+// Profiling is off unless ProfiledInstrumentation is chosen explicitly, in any build type.
+using DefaultInstrumentation = NoInstrumentation;
+
+#endif //TP__INSTRUMENTATION_POLICY_H_
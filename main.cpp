@@ -1,6 +1,17 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <deque>
 #include "thread_pool.h"
+#include "strand.h"
+#include "combinable.h"
+#include "pipeline.h"
+#include <cstring>
+#include <ctime>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/socket.h>
+#endif
 
 using namespace std::chrono_literals;
 
@@ -117,12 +128,778 @@ void taskTest(std::size_t thread_count = std::thread::hardware_concurrency()) {
   std::cout << "OpenMP : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
 }
 
+template<typename Pool>
+void countTasks(Pool& thread_pool, int tasks_count) {
+  std::atomic_int completed_tasks_count = 0;
+  for (auto i = 0; i < tasks_count; ++i) {
+    thread_pool.add([&completed_tasks_count] { ++completed_tasks_count; });
+  }
+  thread_pool.waitTasks();
+  assert(completed_tasks_count == tasks_count && "Policy pool lost tasks.");
+}
+
+void policiesTest() {
+  constexpr auto tasks_count = 1000;
+  using Task = std::function<void()>;
+
+  static_assert(std::is_same_v<DefaultInstrumentation, NoInstrumentation>,
+                "Profiling must only be enabled explicitly.");
+
+  // Holds in release builds as well: profiling does not depend on NDEBUG.
+  auto profiler = std::make_shared<Profiler>();
+  {
+    ProfiledThreadPool thread_pool(profiler, 3, DestructionPolicy::WAIT_ALL);
+    countTasks(thread_pool, tasks_count);
+  }
+  assert(profiler->completedTasksCount() == tasks_count && "Profiled pool did not log its tasks.");
+  std::cout << "Profiled pool logged " << profiler->completedTasksCount() << " tasks\n";
+
+  {
+    BasicThreadPool<Task, DynamicPlacement, NoInstrumentation, SpinningIdle<>> thread_pool(3);
+    countTasks(thread_pool, tasks_count);
+  }
+  {
+    BasicThreadPool<Task, PowerOfTwoChoicesPlacement> thread_pool(3);
+    countTasks(thread_pool, tasks_count);
+  }
+  {
+    BasicThreadPool<Task, LeastLoadedPlacement<2>, ProfiledInstrumentation, SpinningIdle<16>> thread_pool(3);
+    countTasks(thread_pool, tasks_count);
+  }
+  std::cout << "Policy checks passed\n";
+}
+
+void spinFor(std::chrono::high_resolution_clock::duration duration) {
+  const auto end = std::chrono::high_resolution_clock::now() + duration;
+  while (std::chrono::high_resolution_clock::now() < end) {
+  }
+}
+
+void placementTest(std::size_t thread_count = std::thread::hardware_concurrency()) {
+  constexpr auto bursts_count = 200;
+  constexpr auto tasks_per_burst = 500;
+  constexpr auto tasks_count = bursts_count * tasks_per_burst;
+  constexpr auto pause_between_bursts = 1ms;
+  using duration_cast_type = std::chrono::microseconds;
+  using Clock = std::chrono::high_resolution_clock;
+
+  const std::vector<std::pair<std::string, PlacementPolicy>> policies = {
+      {"random", PlacementPolicy::RANDOM},
+      {"power of two choices", PlacementPolicy::POWER_OF_TWO_CHOICES},
+      {"least loaded of k", PlacementPolicy::LEAST_LOADED_OF_K}
+  };
+
+  std::vector<Clock::duration> queue_waits(tasks_count);
+  for (const auto& [name, placement_policy] : policies) {
+    {
+      ThreadPool thread_pool(thread_count, DestructionPolicy::WAIT_ALL, placement_policy);
+      for (auto burst = 0; burst < bursts_count; ++burst) {
+        for (auto i = 0; i < tasks_per_burst; ++i) {
+          const auto index = burst * tasks_per_burst + i;
+          const auto enqueued = Clock::now();
+          // Every tenth task is ten times longer so that unlucky workers build up a backlog.
+          const auto work = (index % 10 == 0) ? 50us : 5us;
+          thread_pool.add([&queue_waits, index, enqueued, work] {
+            queue_waits[index] = Clock::now() - enqueued;
+            spinFor(work);
+          });
+        }
+        std::this_thread::sleep_for(pause_between_bursts);
+      }
+    }
+
+    std::sort(queue_waits.begin(), queue_waits.end());
+    const auto percentile = [&queue_waits](double p) {
+      const auto index = static_cast<std::size_t>(p * (queue_waits.size() - 1));
+      return std::chrono::duration_cast<duration_cast_type>(queue_waits[index]).count();
+    };
+    std::cout << "Queue wait with " << name << " placement (us) : p50 " << percentile(0.5)
+              << ", p99 " << percentile(0.99)
+              << ", p99.9 " << percentile(0.999)
+              << ", max " << percentile(1.0) << "\n";
+  }
+}
+
+// The default size is chosen so that a worker's shard fits in its private caches but the whole array does not fit in one core's.
+void affinityTest(std::size_t thread_count = std::thread::hardware_concurrency(),
+                  std::size_t vector_size = 1 << 20,
+                  int iterations_count = 200) {
+  using duration_cast_type = std::chrono::milliseconds;
+  using Clock = std::chrono::high_resolution_clock;
+
+  auto f = [](double& x) { x = x * 0.5 + 1.0; };
+
+  std::vector<double> v(vector_size, 0.0);
+  ThreadPool thread_pool(thread_count);
+
+  // Same split as the affinity partitioner, but every chunk goes to a randomly placed worker.
+  const auto chunk_size = vector_size / thread_count;
+  auto start = Clock::now();
+  for (auto i = 0; i < iterations_count; ++i) {
+    for (auto chunk = 0; chunk < thread_count; ++chunk) {
+      const auto first = v.begin() + chunk * chunk_size;
+      const auto last = chunk + 1 == thread_count ? v.end() : first + chunk_size;
+      thread_pool.add([first, last, f] { std::for_each(first, last, f); });
+    }
+    thread_pool.waitTasks();
+  }
+  auto end = Clock::now();
+  std::cout << "Iterative chunked add without affinity took : "
+            << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+
+  std::fill(v.begin(), v.end(), 0.0);
+  AffinityPartitioner partitioner;
+  start = Clock::now();
+  for (auto i = 0; i < iterations_count; ++i) {
+    thread_pool.forEach(v.begin(), v.end(), f, partitioner);
+    thread_pool.waitTasks();
+  }
+  end = Clock::now();
+  std::cout << "Iterative forEach with affinity partitioner took : "
+            << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  std::for_each(v.begin(), v.end(), [](double x) { assert(x > 1.99 && x <= 2.0 && "affinityTest assertion failed."); });
+}
+
+void forEachChunkTest(std::size_t thread_count = std::thread::hardware_concurrency(), std::size_t vector_size = 1 << 20) {
+  constexpr int val = 1;
+  constexpr int mult = 3;
+  constexpr int prod = val * mult;
+  using duration_cast_type = std::chrono::microseconds;
+  using Clock = std::chrono::high_resolution_clock;
+
+  std::vector<int> v(vector_size, val);
+  ThreadPool thread_pool(thread_count);
+
+  auto start = Clock::now();
+  thread_pool.forEach(v.begin(), v.end(), [mult](int& x) { x *= mult; });
+  thread_pool.waitTasks();
+  auto end = Clock::now();
+  std::cout << "Element-wise forEach took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  std::for_each(v.begin(), v.end(), [](int x) { assert(x == prod && "Element-wise forEach assertion failed."); });
+  std::fill(v.begin(), v.end(), val);
+
+  start = Clock::now();
+  thread_pool.forEachChunk(v.begin(), v.end(), [mult](std::span<int> chunk) {
+    for (auto& x : chunk) {
+      x *= mult;
+    }
+  });
+  thread_pool.waitTasks();
+  end = Clock::now();
+  std::cout << "forEachChunk took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  std::for_each(v.begin(), v.end(), [](int x) { assert(x == prod && "forEachChunk assertion failed."); });
+  std::fill(v.begin(), v.end(), val);
+
+  auto* data = v.data();
+  start = Clock::now();
+  thread_pool.forEachIndex(0, v.size(), [data, mult](std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      data[i] *= mult;
+    }
+  });
+  thread_pool.waitTasks();
+  end = Clock::now();
+  std::cout << "forEachIndex took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  std::for_each(v.begin(), v.end(), [](int x) { assert(x == prod && "forEachIndex assertion failed."); });
+  std::fill(v.begin(), v.end(), val);
+
+  start = Clock::now();
+#pragma omp parallel for simd num_threads(thread_count)
+  for (std::size_t i = 0; i < vector_size; ++i) {
+    data[i] *= mult;
+  }
+  end = Clock::now();
+  std::cout << "OpenMP parallel for simd took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  std::for_each(v.begin(), v.end(), [](int x) { assert(x == prod && "OpenMP parallel for simd assertion failed."); });
+}
+
+void blockedRangeTest(std::size_t thread_count = std::thread::hardware_concurrency(), std::size_t n = 4096) {
+  constexpr size_t tile = 64;
+  using duration_cast_type = std::chrono::milliseconds;
+  using Clock = std::chrono::high_resolution_clock;
+
+  std::vector<double> a(n * n);
+  std::vector<double> b(n * n, 0.0);
+  for (auto i = 0; i < a.size(); ++i) {
+    a[i] = static_cast<double>(i);
+  }
+  const auto* src = a.data();
+  auto* dst = b.data();
+
+  ThreadPool thread_pool(thread_count);
+
+  auto start = Clock::now();
+  thread_pool.forEachIndex(0, n, [src, dst, n](std::size_t rows_begin, std::size_t rows_end) {
+    for (auto i = rows_begin; i < rows_end; ++i) {
+      for (auto j = 0; j < n; ++j) {
+        dst[j * n + i] = src[i * n + j];
+      }
+    }
+  }, 1);
+  thread_pool.waitTasks();
+  auto end = Clock::now();
+  std::cout << "Flat row-wise transpose took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  for (auto i = 0; i < n; i += 97) {
+    for (auto j = 0; j < n; j += 89) {
+      assert(b[j * n + i] == a[i * n + j] && "Flat row-wise transpose assertion failed.");
+    }
+  }
+  std::fill(b.begin(), b.end(), 0.0);
+
+  start = Clock::now();
+  thread_pool.parallelFor(BlockedRange2D(0, n, 0, n, tile, tile), [src, dst, n](const BlockedRange2D& range) {
+    for (auto i = range.rowsBegin(); i < range.rowsEnd(); ++i) {
+      for (auto j = range.colsBegin(); j < range.colsEnd(); ++j) {
+        dst[j * n + i] = src[i * n + j];
+      }
+    }
+  });
+  thread_pool.waitTasks();
+  end = Clock::now();
+  std::cout << "Blocked 2D transpose took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  for (auto i = 0; i < n; i += 97) {
+    for (auto j = 0; j < n; j += 89) {
+      assert(b[j * n + i] == a[i * n + j] && "Blocked 2D transpose assertion failed.");
+    }
+  }
+}
+
+void strandTest(std::size_t thread_count = std::thread::hardware_concurrency(), int strands_count = 100000) {
+  constexpr auto tasks_per_strand = 10;
+  using duration_cast_type = std::chrono::milliseconds;
+  using Clock = std::chrono::high_resolution_clock;
+
+  std::vector<int> last_seen(strands_count, -1);
+  ThreadPool thread_pool(thread_count);
+
+  {
+    std::vector<std::mutex> mutexes(strands_count);
+    auto start = Clock::now();
+    for (auto i = 0; i < tasks_per_strand; ++i) {
+      for (auto key = 0; key < strands_count; ++key) {
+        thread_pool.add([&mutexes, &last_seen, key, i] {
+          std::lock_guard<std::mutex> lock(mutexes[key]);
+          last_seen[key] = std::max(last_seen[key], i);
+        });
+      }
+    }
+    thread_pool.waitTasks();
+    auto end = Clock::now();
+    std::cout << "Mutex per key took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  }
+  std::fill(last_seen.begin(), last_seen.end(), -1);
+
+  std::deque<Strand<>> strands;
+  for (auto key = 0; key < strands_count; ++key) {
+    strands.emplace_back(thread_pool);
+  }
+  auto start = Clock::now();
+  for (auto i = 0; i < tasks_per_strand; ++i) {
+    for (auto key = 0; key < strands_count; ++key) {
+      strands[key].post([&last_seen, key, i] {
+        assert(last_seen[key] + 1 == i && "Strand tasks ran out of order.");
+        last_seen[key] = i;
+      });
+    }
+  }
+  thread_pool.waitTasks();
+  auto end = Clock::now();
+  std::cout << "Strand per key took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  std::for_each(last_seen.begin(), last_seen.end(), [](int x) { assert(x == tasks_per_strand - 1 && "strandTest assertion failed."); });
+}
+
+void backpressureTest(std::size_t thread_count = std::thread::hardware_concurrency(),
+                      std::size_t tasks_count = 100000,
+                      std::size_t capacity = 1000) {
+  constexpr auto work = 5us;
+  using duration_cast_type = std::chrono::milliseconds;
+  using Clock = std::chrono::high_resolution_clock;
+
+  const std::vector<std::pair<std::string, OverflowPolicy>> policies = {
+      {"block", OverflowPolicy::BLOCK},
+      {"reject", OverflowPolicy::REJECT},
+      {"caller runs", OverflowPolicy::CALLER_RUNS}
+  };
+
+  for (const auto& [name, overflow_policy] : policies) {
+    std::atomic_size_t completed_tasks_count = 0;
+    std::size_t max_queue_depth = 0;
+
+    const auto start = Clock::now();
+    ThreadPool thread_pool(thread_count, DestructionPolicy::WAIT_ALL, PlacementPolicy::RANDOM, capacity, overflow_policy);
+    for (std::size_t i = 0; i < tasks_count; ++i) {
+      thread_pool.add([&completed_tasks_count, work] {
+        spinFor(work);
+        ++completed_tasks_count;
+      });
+      max_queue_depth = std::max(max_queue_depth, thread_pool.queueDepth());
+    }
+    thread_pool.waitTasks();
+    const auto end = Clock::now();
+
+    std::cout << "Overflow policy " << name << " took : "
+              << std::chrono::duration_cast<duration_cast_type>(end - start).count()
+              << ", completed " << completed_tasks_count
+              << ", rejected " << thread_pool.rejectedCount()
+              << ", max queue depth " << max_queue_depth << "\n";
+    assert(completed_tasks_count + thread_pool.rejectedCount() == tasks_count && "backpressureTest assertion failed.");
+  }
+}
+
+void clearTasksTest() {
+  constexpr std::size_t capacity = 4;
+
+  ThreadPool thread_pool(1, DestructionPolicy::WAIT_ALL, PlacementPolicy::RANDOM, capacity, OverflowPolicy::REJECT);
+  std::atomic_bool started = false;
+  std::atomic_bool released = false;
+  thread_pool.add([&started, &released] {
+    started = true;
+    while (!released) {
+      std::this_thread::yield();
+    }
+  });
+  while (!started) {
+    std::this_thread::yield();
+  }
+
+  std::atomic_int completed_tasks_count = 0;
+  for (auto i = 1; i < capacity; ++i) {
+    thread_pool.add([&completed_tasks_count] { ++completed_tasks_count; });
+  }
+  assert(thread_pool.queueDepth() == capacity && "clearTasksTest setup failed.");
+
+  // Cleared tasks must give their room back, or every clear shrinks the pool for good.
+  thread_pool.clearTasks();
+  assert(thread_pool.queueDepth() == 1 && "Cleared tasks still counted in queue depth.");
+  released = true;
+  thread_pool.waitTasks();
+  assert(thread_pool.queueDepth() == 0 && completed_tasks_count == 0 && "clearTasksTest assertion failed.");
+
+  for (auto i = 0; i < capacity; ++i) {
+    [[maybe_unused]] const auto added = thread_pool.add([&completed_tasks_count] { ++completed_tasks_count; });
+    assert(added && "Cleared tasks took capacity from add().");
+  }
+  thread_pool.waitTasks();
+  assert(completed_tasks_count == capacity && thread_pool.rejectedCount() == 0 && "clearTasksTest assertion failed.");
+  std::cout << "Clear tasks checks passed\n";
+}
+
+void blockingAddTest() {
+  constexpr auto busy_time = 200ms;
+
+  ThreadPool thread_pool(1, DestructionPolicy::WAIT_ALL, PlacementPolicy::RANDOM, 1, OverflowPolicy::BLOCK);
+  std::atomic_bool started = false;
+  thread_pool.add([&started, busy_time] {
+    started = true;
+    std::this_thread::sleep_for(busy_time);
+  });
+  while (!started) {
+    std::this_thread::yield();
+  }
+
+  // The timed add gives up at its deadline while the worker is still busy.
+  const auto timed_start = std::chrono::steady_clock::now();
+  [[maybe_unused]] const auto timed_added = thread_pool.add([] {}, 20ms);
+  assert(!timed_added && std::chrono::steady_clock::now() - timed_start >= 20ms && "Timed add did not wait for its deadline.");
+
+  // A blocked producer sleeps until the worker frees room instead of burning a core.
+  const auto cpu_start = std::clock();
+  std::atomic_bool ran = false;
+  [[maybe_unused]] const auto added = thread_pool.add([&ran] { ran = true; });
+  const auto cpu_time = std::chrono::duration<double>(double(std::clock() - cpu_start) / CLOCKS_PER_SEC);
+  thread_pool.waitTasks();
+  assert(added && ran && thread_pool.rejectedCount() == 1 && "blockingAddTest assertion failed.");
+  assert(cpu_time < busy_time / 2 && "Blocked add() kept a core busy.");
+  std::cout << "Blocking add checks passed\n";
+}
+
+void scratchTest(std::size_t thread_count = std::thread::hardware_concurrency(), int tasks_count = 100000) {
+  constexpr std::size_t buffer_size = 256;
+  using duration_cast_type = std::chrono::milliseconds;
+  using Clock = std::chrono::high_resolution_clock;
+
+  ThreadPool thread_pool(thread_count);
+
+  std::atomic_llong atomic_sum = 0;
+  auto start = Clock::now();
+  for (auto i = 0; i < tasks_count; ++i) {
+    thread_pool.add([&atomic_sum, i] {
+      std::vector<int> buffer(buffer_size, i);
+      for (auto x : buffer) {
+        atomic_sum += x;
+      }
+    });
+  }
+  thread_pool.waitTasks();
+  auto end = Clock::now();
+  std::cout << "Heap buffers with atomic sum took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+
+  Combinable<long long> sum(thread_pool);
+  start = Clock::now();
+  for (auto i = 0; i < tasks_count; ++i) {
+    thread_pool.add([&thread_pool, &sum, i] {
+      auto* buffer = thread_pool.scratch().allocateArray<int>(buffer_size);
+      std::fill(buffer, buffer + buffer_size, i);
+      auto& local_sum = sum.local();
+      for (auto j = 0; j < buffer_size; ++j) {
+        local_sum += buffer[j];
+      }
+    });
+  }
+  thread_pool.waitTasks();
+  end = Clock::now();
+  std::cout << "Scratch buffers with combinable sum took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  assert(sum.combine(std::plus<>()) == atomic_sum && "scratchTest assertion failed.");
+}
+
+void pipelineTest(std::size_t thread_count = std::thread::hardware_concurrency(),
+                  int records_count = 200000,
+                  std::size_t batch_size = 10000) {
+  constexpr auto tokens_count = 16;
+  constexpr auto work = 2us;
+  using duration_cast_type = std::chrono::milliseconds;
+  using Clock = std::chrono::high_resolution_clock;
+
+  struct Record {
+    std::string text;
+    long long value = 0;
+  };
+
+  const auto read = [](int i, Record& record) { record.text = std::to_string(i); };
+  const auto parse = [work](Record& record) {
+    spinFor(work);
+    record.value = std::stoll(record.text);
+  };
+  const auto transform = [work](Record& record) {
+    spinFor(work);
+    record.value *= 3;
+  };
+
+  ThreadPool thread_pool(thread_count);
+
+  long long batch_sum = 0;
+  std::vector<long long> batch_output;
+  auto start = Clock::now();
+  for (auto first = 0; first < records_count; first += batch_size) {
+    std::vector<Record> batch(std::min<std::size_t>(batch_size, records_count - first));
+    for (auto i = 0; i < batch.size(); ++i) {
+      read(first + i, batch[i]);
+    }
+    thread_pool.forEachChunk(batch.begin(), batch.end(), [&parse](std::span<Record> chunk) {
+      std::for_each(chunk.begin(), chunk.end(), parse);
+    });
+    thread_pool.waitTasks();
+    thread_pool.forEachChunk(batch.begin(), batch.end(), [&transform](std::span<Record> chunk) {
+      std::for_each(chunk.begin(), chunk.end(), transform);
+    });
+    thread_pool.waitTasks();
+    for (auto& record : batch) {
+      batch_sum += record.value;
+      batch_output.push_back(record.value);
+    }
+  }
+  auto end = Clock::now();
+  std::cout << "Batch and wait (" << batch_size << " records in flight) took : "
+            << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+
+  long long pipeline_sum = 0;
+  std::vector<long long> pipeline_output;
+  auto next = 0;
+  Pipeline<Record> pipeline(thread_pool, [&next, &read, records_count](Record& record) {
+    if (next == records_count) {
+      return false;
+    }
+    read(next++, record);
+    return true;
+  });
+  pipeline.addFilter(FilterMode::PARALLEL, parse)
+      .addFilter(FilterMode::PARALLEL, transform)
+      .addFilter(FilterMode::SERIAL_OUT_OF_ORDER, [&pipeline_sum](Record& record) { pipeline_sum += record.value; })
+      .addFilter(FilterMode::SERIAL_IN_ORDER, [&pipeline_output](Record& record) { pipeline_output.push_back(record.value); });
+  start = Clock::now();
+  pipeline.run(tokens_count);
+  end = Clock::now();
+  std::cout << "Pipeline (" << tokens_count << " records in flight) took : "
+            << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+
+  assert(pipeline_sum == batch_sum && "pipelineTest sum assertion failed.");
+  assert(pipeline_output == batch_output && "pipelineTest order assertion failed.");
+}
+
+#ifdef __linux__
+void reactorTest(std::size_t thread_count = std::thread::hardware_concurrency()) {
+  ThreadPool thread_pool(thread_count);
+  auto& reactor = thread_pool.reactor();
+
+  int pipe_fds[2];
+  [[maybe_unused]] const auto pipe_created = pipe(pipe_fds);
+  assert(pipe_created == 0 && "pipe failed.");
+  char pipe_buffer[6] = {};
+  long pipe_result = 0;
+  reactor.asyncRead(pipe_fds[0], pipe_buffer, 5, [&pipe_result](long result) { pipe_result = result; });
+  thread_pool.add([pipe_fds] {
+    [[maybe_unused]] const auto written = write(pipe_fds[1], "hello", 5);
+    assert(written == 5 && "pipe write failed.");
+  });
+  thread_pool.waitTasks();
+  assert(pipe_result == 5 && std::strcmp(pipe_buffer, "hello") == 0 && "Reactor pipe read assertion failed.");
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+
+  int socket_fds[2];
+  [[maybe_unused]] const auto socket_created = socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds);
+  assert(socket_created == 0 && "socketpair failed.");
+  char socket_buffer[5] = {};
+  long socket_result = 0;
+  reactor.asyncRead(socket_fds[1], socket_buffer, 4, [&socket_result](long result) { socket_result = result; });
+  reactor.asyncWrite(socket_fds[0], "ping", 4, [](long result) { assert(result == 4 && "Reactor socket write assertion failed."); });
+  thread_pool.waitTasks();
+  assert(socket_result == 4 && std::strcmp(socket_buffer, "ping") == 0 && "Reactor socket read assertion failed.");
+  close(socket_fds[0]);
+  close(socket_fds[1]);
+
+  char file_name[] = "/tmp/tp_reactor_XXXXXX";
+  const auto file_fd = mkstemp(file_name);
+  [[maybe_unused]] const auto file_written = write(file_fd, "file", 4);
+  lseek(file_fd, 0, SEEK_SET);
+  assert(file_fd >= 0 && file_written == 4 && "temp file setup failed.");
+  char file_buffer[5] = {};
+  long file_result = 0;
+  reactor.asyncRead(file_fd, file_buffer, 4, [&file_result](long result) { file_result = result; });
+  thread_pool.waitTasks();
+  assert(file_result == 4 && std::strcmp(file_buffer, "file") == 0 && "Reactor file read assertion failed.");
+  close(file_fd);
+  unlink(file_name);
+
+  const auto timeout_start = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration timeout_elapsed{};
+  reactor.asyncTimeout(5ms, [&timeout_elapsed, timeout_start] {
+    timeout_elapsed = std::chrono::steady_clock::now() - timeout_start;
+  });
+  thread_pool.waitTasks();
+  assert(timeout_elapsed >= 5ms && "Reactor timeout assertion failed.");
+  std::cout << "Reactor pipe, socketpair, file and timeout checks passed\n";
+}
+
+void reactorCapacityTest() {
+  constexpr std::size_t capacity = 2;
+  constexpr auto reads_count = 2;
+
+  ThreadPool thread_pool(4, DestructionPolicy::WAIT_ALL, PlacementPolicy::RANDOM, capacity, OverflowPolicy::REJECT);
+  auto& reactor = thread_pool.reactor();
+
+  int pipe_fds[reads_count][2];
+  char buffers[reads_count] = {};
+  std::atomic_int completed_reads_count = 0;
+  for (auto i = 0; i < reads_count; ++i) {
+    [[maybe_unused]] const auto pipe_created = pipe(pipe_fds[i]);
+    assert(pipe_created == 0 && "pipe failed.");
+    reactor.asyncRead(pipe_fds[i][0], &buffers[i], 1, [&completed_reads_count](long result) {
+      assert(result == 1 && "Reactor capacity read assertion failed.");
+      ++completed_reads_count;
+    });
+  }
+
+  // Parked reads hold no worker, so they must neither fill the pool nor count as queued tasks.
+  assert(thread_pool.queueDepth() == 0 && "Pending reads counted in queue depth.");
+  std::atomic_int completed_tasks_count = 0;
+  for (auto i = 0; i < capacity; ++i) {
+    [[maybe_unused]] const auto added = thread_pool.add([&completed_tasks_count] { ++completed_tasks_count; });
+    assert(added && "Pending reads took capacity from add().");
+  }
+  while (completed_tasks_count != capacity) {
+    std::this_thread::yield();
+  }
+  assert(completed_reads_count == 0 && thread_pool.rejectedCount() == 0 && "reactorCapacityTest assertion failed.");
+
+  for (auto i = 0; i < reads_count; ++i) {
+    [[maybe_unused]] const auto written = write(pipe_fds[i][1], "x", 1);
+  }
+  // waitTasks() still has to wait for the reads and their continuations.
+  thread_pool.waitTasks();
+  assert(completed_reads_count == reads_count && "waitTasks() did not wait for pending reads.");
+  for (auto& fds : pipe_fds) {
+    close(fds[0]);
+    close(fds[1]);
+  }
+  std::cout << "Reactor capacity checks passed\n";
+}
+
+void reactorCancelTest() {
+  ThreadPool thread_pool(2, DestructionPolicy::WAIT_ALL);
+  auto& reactor = thread_pool.reactor();
+
+  int pipe_fds[2];
+  [[maybe_unused]] const auto pipe_created = pipe(pipe_fds);
+  assert(pipe_created == 0 && "pipe failed.");
+  char buffer = 0;
+  std::atomic_long read_result = 0;
+  reactor.asyncRead(pipe_fds[0], &buffer, 1, [&read_result](long result) { read_result = result; });
+
+  // Nothing is ever written, so only waiting for the queued tasks may return.
+  thread_pool.waitTasks(false);
+  assert(read_result == 0 && "Reactor read completed without data.");
+
+  [[maybe_unused]] const auto cancelled_count = reactor.cancel(pipe_fds[0]);
+  thread_pool.waitTasks();
+  assert(cancelled_count == 1 && read_result == -ECANCELED && "Reactor cancel assertion failed.");
+  assert(reactor.cancel(pipe_fds[0]) == 0 && "Reactor cancelled an operation twice.");
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+
+  // Cancelled descriptors can be watched again.
+  [[maybe_unused]] const auto pipe_recreated = pipe(pipe_fds);
+  assert(pipe_recreated == 0 && "pipe failed.");
+  reactor.asyncRead(pipe_fds[0], &buffer, 1, [&read_result](long result) { read_result = result; });
+  [[maybe_unused]] const auto written = write(pipe_fds[1], "x", 1);
+  thread_pool.waitTasks();
+  assert(read_result == 1 && buffer == 'x' && "Reactor read after cancel assertion failed.");
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  std::cout << "Reactor cancel checks passed\n";
+}
+
+// Answers every one-byte request on its socket after a fixed latency, like a remote service.
+// Takes ownership of the sockets.
+class DelayedResponder {
+ public:
+  DelayedResponder(const std::vector<int>& fds, std::chrono::microseconds latency)
+      : fds(fds), latency(latency), stopped(false), thread(&DelayedResponder::run, this) {}
+
+  ~DelayedResponder() {
+    stopped = true;
+    thread.join();
+    for (auto fd : fds) {
+      close(fd);
+    }
+  }
+ private:
+  void run() {
+    using Clock = std::chrono::steady_clock;
+    std::vector<pollfd> poll_fds;
+    for (auto fd : fds) {
+      poll_fds.push_back({fd, POLLIN, 0});
+    }
+    std::deque<std::pair<Clock::time_point, int>> responses;
+    while (!stopped) {
+      const auto now = Clock::now();
+      while (!responses.empty() && responses.front().first <= now) {
+        [[maybe_unused]] const auto written = write(responses.front().second, "r", 1);
+        responses.pop_front();
+      }
+      if (::poll(poll_fds.data(), poll_fds.size(), 0) > 0) {
+        for (auto& poll_fd : poll_fds) {
+          char request;
+          if ((poll_fd.revents & POLLIN) != 0 && read(poll_fd.fd, &request, 1) == 1) {
+            responses.emplace_back(Clock::now() + latency, poll_fd.fd);
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<int> fds;
+  std::chrono::microseconds latency;
+  std::atomic_bool stopped;
+  std::thread thread;
+};
+
+void reactorBenchmark(std::size_t thread_count = std::thread::hardware_concurrency()) {
+  constexpr auto requests_count = 256;
+  constexpr auto latency = 1ms;
+  constexpr auto work = 20us;
+  using duration_cast_type = std::chrono::milliseconds;
+  using Clock = std::chrono::high_resolution_clock;
+
+  std::vector<int> client_fds;
+  std::vector<int> server_fds;
+  for (auto i = 0; i < requests_count; ++i) {
+    int fds[2];
+    [[maybe_unused]] const auto socket_created = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert(socket_created == 0 && "socketpair failed.");
+    client_fds.push_back(fds[0]);
+    server_fds.push_back(fds[1]);
+  }
+  DelayedResponder responder(server_fds, latency);
+  std::atomic_size_t completed_requests_count = 0;
+
+  {
+    ThreadPool thread_pool(thread_count);
+    const auto start = Clock::now();
+    for (auto fd : client_fds) {
+      thread_pool.add([fd, work, &completed_requests_count] {
+        char response;
+        [[maybe_unused]] const auto written = write(fd, "q", 1);
+        [[maybe_unused]] const auto received = read(fd, &response, 1);
+        spinFor(work);
+        ++completed_requests_count;
+      });
+    }
+    thread_pool.waitTasks();
+    const auto end = Clock::now();
+    std::cout << "Blocking reads took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  }
+
+  {
+    ThreadPool thread_pool(thread_count);
+    auto& reactor = thread_pool.reactor();
+    std::vector<char> responses(requests_count);
+    const auto start = Clock::now();
+    for (auto i = 0; i < requests_count; ++i) {
+      const auto fd = client_fds[i];
+      thread_pool.add([&reactor, &responses, fd, i, work, &completed_requests_count] {
+        [[maybe_unused]] const auto written = write(fd, "q", 1);
+        reactor.asyncRead(fd, &responses[i], 1, [work, &completed_requests_count](long) {
+          spinFor(work);
+          ++completed_requests_count;
+        });
+      });
+    }
+    thread_pool.waitTasks();
+    const auto end = Clock::now();
+    std::cout << "Reactor reads took : " << std::chrono::duration_cast<duration_cast_type>(end - start).count() << "\n";
+  }
+
+  assert(completed_requests_count == 2 * requests_count && "reactorBenchmark assertion failed.");
+  for (auto fd : client_fds) {
+    close(fd);
+  }
+}
+#endif
+
 int main() {
   std::cout << "hardware_concurrency: " << std::thread::hardware_concurrency() << "\n";
+  policiesTest();
+  clearTasksTest();
+  blockingAddTest();
+  affinityTest(4, 1 << 12, 20);
+  // An odd size leaves a partial block at the end.
+  forEachChunkTest(4, 100003);
+  // Not a multiple of the tile size, so the edge tiles are partial.
+  blockedRangeTest(4, 300);
+  strandTest(4, 1000);
+  backpressureTest(4, 5000, 100);
+  scratchTest(4, 2000);
+  pipelineTest(4, 5000, 1000);
+#ifdef __linux__
+  reactorTest(4);
+  reactorCapacityTest();
+  reactorCancelTest();
+#endif
   forEachTest(4);
+  // Full-size benchmarks, too slow to run every time.
+//  placementTest(4);
+//  affinityTest(4);
+//  forEachChunkTest(4);
+//  blockedRangeTest(4);
+//  strandTest(4);
+//  backpressureTest(4);
+//  scratchTest(4);
+//  pipelineTest(4);
+//  reactorBenchmark(4);
 
   //auto profiler = std::make_shared<Profiler>();
-  //ThreadPool thread_pool(profiler, 3, DestructionPolicy::WAIT_CURRENT);
+  //ProfiledThreadPool thread_pool(profiler, 3, DestructionPolicy::WAIT_CURRENT);
 //  ThreadPool thread_pool(3, DestructionPolicy::WAIT_CURRENT);
 //  for (auto i = 0; i < 10; ++i) {
 //    thread_pool.add([i] {
@@ -0,0 +1,8 @@
+#ifndef TP__OVERFLOW_POLICY_H_
+#define TP__OVERFLOW_POLICY_H_
+
+enum class OverflowPolicy {
+  BLOCK, REJECT, CALLER_RUNS
+};
+
+#endif //TP__OVERFLOW_POLICY_H_
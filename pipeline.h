@@ -0,0 +1,204 @@
+#ifndef TP__PIPELINE_H_
+#define TP__PIPELINE_H_
+
+#include <cassert>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "filter_mode.h"
+#include "thread_pool.h"
+
+// Streams items through a chain of filters on the pool's workers. A fixed number of tokens, each
+// holding one item, circulate through the pipeline, so at most that many items are in flight.
+// A token carries its item through consecutive filters on the same worker; it only leaves that
+// worker when it has to wait for a serial filter, and is then resumed by whichever token frees it.
+//  - PARALLEL filters run on any number of items at once,
+//  - SERIAL_OUT_OF_ORDER filters run on one item at a time, in any order,
+//  - SERIAL_IN_ORDER filters run on one item at a time, in the order the source produced them.
+// The source itself is serial: it fills the next item and returns false once the stream ends.
+template<typename T, typename Pool = ThreadPool>
+class Pipeline {
+ public:
+  using Source = std::function<bool(T&)>;
+  using Filter = std::function<void(T&)>;
+
+  Pipeline(Pool& pool, Source source);
+
+  Pipeline(const Pipeline&) = delete;
+  Pipeline& operator=(const Pipeline&) = delete;
+
+  Pipeline& addFilter(FilterMode mode, Filter filter);
+
+  // Blocks until every item produced by the source passed through all filters. The caller spins
+  // while waiting, so call it from outside the pool.
+  void run(std::size_t max_tokens = std::thread::hardware_concurrency());
+ private:
+  struct Token {
+    T item;
+    std::size_t sequence = 0;
+  };
+
+  struct Stage {
+    Stage(FilterMode mode, Filter filter) : mode(mode), filter(std::move(filter)) {}
+
+    FilterMode mode;
+    Filter filter;
+
+    std::mutex mutex;
+    bool busy = false;
+    std::size_t next_sequence = 0;
+    std::map<std::size_t, Token*> ordered_waiting_tokens;
+    std::deque<Token*> waiting_tokens;
+  };
+
+  // Moves the token from stage_index onwards until it has to wait or the source is exhausted.
+  // holds_stage tells that the token was handed the serial stage at stage_index by leave().
+  void advance(Token* token, std::size_t stage_index, bool holds_stage);
+  void resume(Token* token, std::size_t stage_index, bool holds_stage);
+
+  // Returns false when the token was parked because the serial stage is taken or it is not its turn.
+  bool enter(Stage& stage, Token* token);
+  // Releases the stage and hands it to the next waiting token, which the caller must resume.
+  Token* leave(Stage& stage);
+
+  Pool& pool;
+  Source source;
+  Stage input_stage;
+  std::deque<Stage> stages;
+
+  // Only accessed while holding the input stage.
+  bool exhausted;
+  std::size_t next_input_sequence;
+
+  std::atomic_size_t active_tokens_count;
+};
+
+template<typename T, typename Pool>
+Pipeline<T, Pool>::Pipeline(Pool& pool, Source source)
+    : pool(pool),
+      source(std::move(source)),
+      input_stage(FilterMode::SERIAL_OUT_OF_ORDER, nullptr),
+      exhausted(false),
+      next_input_sequence(0),
+      active_tokens_count(0) {
+}
+
+template<typename T, typename Pool>
+Pipeline<T, Pool>& Pipeline<T, Pool>::addFilter(FilterMode mode, Filter filter) {
+  stages.emplace_back(mode, std::move(filter));
+  return *this;
+}
+
+template<typename T, typename Pool>
+void Pipeline<T, Pool>::run(std::size_t max_tokens) {
+  assert(max_tokens > 0 && "The supplied max tokens count cannot be 0");
+
+  exhausted = false;
+  next_input_sequence = 0;
+  for (auto& stage : stages) {
+    stage.next_sequence = 0;
+  }
+
+  std::vector<Token> tokens(max_tokens);
+  active_tokens_count = max_tokens;
+  for (auto& token : tokens) {
+    resume(&token, 0, false);
+  }
+
+  while (active_tokens_count != 0) {
+    std::this_thread::yield();
+  }
+}
+
+template<typename T, typename Pool>
+void Pipeline<T, Pool>::advance(Token* token, std::size_t stage_index, bool holds_stage) {
+  for (;; holds_stage = false) {
+    if (stage_index == 0) {
+      if (!holds_stage && !enter(input_stage, token)) {
+        return;
+      }
+      const auto produced = !exhausted && source(token->item);
+      if (produced) {
+        token->sequence = next_input_sequence++;
+      } else {
+        exhausted = true;
+      }
+      if (auto* next_token = leave(input_stage)) {
+        resume(next_token, 0, true);
+      }
+      if (!produced) {
+        --active_tokens_count;
+        return;
+      }
+      stage_index = 1;
+      continue;
+    }
+
+    if (stage_index > stages.size()) {
+      stage_index = 0;
+      continue;
+    }
+
+    auto& stage = stages[stage_index - 1];
+    if (stage.mode == FilterMode::PARALLEL) {
+      stage.filter(token->item);
+    } else {
+      if (!holds_stage && !enter(stage, token)) {
+        return;
+      }
+      stage.filter(token->item);
+      if (auto* next_token = leave(stage)) {
+        resume(next_token, stage_index, true);
+      }
+    }
+    ++stage_index;
+  }
+}
+
+template<typename T, typename Pool>
+void Pipeline<T, Pool>::resume(Token* token, std::size_t stage_index, bool holds_stage) {
+  pool.enqueue([this, token, stage_index, holds_stage] { advance(token, stage_index, holds_stage); },
+               pool.currentWorkerIndex());
+}
+
+template<typename T, typename Pool>
+bool Pipeline<T, Pool>::enter(Stage& stage, Token* token) {
+  std::lock_guard<std::mutex> lock(stage.mutex);
+  if (stage.mode == FilterMode::SERIAL_IN_ORDER) {
+    if (stage.busy || token->sequence != stage.next_sequence) {
+      stage.ordered_waiting_tokens.emplace(token->sequence, token);
+      return false;
+    }
+  } else if (stage.busy) {
+    stage.waiting_tokens.push_back(token);
+    return false;
+  }
+
+  stage.busy = true;
+  return true;
+}
+
+template<typename T, typename Pool>
+typename Pipeline<T, Pool>::Token* Pipeline<T, Pool>::leave(Stage& stage) {
+  std::lock_guard<std::mutex> lock(stage.mutex);
+  Token* next_token = nullptr;
+  if (stage.mode == FilterMode::SERIAL_IN_ORDER) {
+    ++stage.next_sequence;
+    const auto it = stage.ordered_waiting_tokens.find(stage.next_sequence);
+    if (it != stage.ordered_waiting_tokens.end()) {
+      next_token = it->second;
+      stage.ordered_waiting_tokens.erase(it);
+    }
+  } else if (!stage.waiting_tokens.empty()) {
+    next_token = stage.waiting_tokens.front();
+    stage.waiting_tokens.pop_front();
+  }
+
+  stage.busy = next_token != nullptr;
+  return next_token;
+}
+
+#endif //TP__PIPELINE_H_
@@ -0,0 +1,124 @@
+#ifndef TP__PLACEMENT_POLICY_H_
+#define TP__PLACEMENT_POLICY_H_
+
+#include <random>
+
+enum class PlacementPolicy {
+  RANDOM, POWER_OF_TWO_CHOICES, LEAST_LOADED_OF_K
+};
+
+// Placement policies pick the worker that receives a task submitted through ThreadPool::add.
+// select() only reads the workers' approximate queue lengths, it never locks a queue, and it is
+// called concurrently from submitters, workers and the reactor, so the random engine is per thread.
+
+class RandomPlacement {
+ public:
+  template<typename Workers>
+  std::size_t select(const Workers& workers);
+ protected:
+  template<typename Workers>
+  std::size_t selectRandom(const Workers& workers);
+  template<typename Workers>
+  std::size_t selectPowerOfTwoChoices(const Workers& workers);
+  template<typename Workers>
+  std::size_t selectLeastLoaded(const Workers& workers, std::size_t sample_count);
+
+  static std::mt19937& engine();
+};
+
+class PowerOfTwoChoicesPlacement : public RandomPlacement {
+ public:
+  template<typename Workers>
+  std::size_t select(const Workers& workers);
+};
+
+template<std::size_t SampleCount = 4>
+class LeastLoadedPlacement : public RandomPlacement {
+ public:
+  template<typename Workers>
+  std::size_t select(const Workers& workers);
+};
+
+// Selects one of the policies above at run time, so that the policy can be a constructor argument.
+class DynamicPlacement : public RandomPlacement {
+ public:
+  // Number of workers sampled by PlacementPolicy::LEAST_LOADED_OF_K.
+  static constexpr std::size_t least_loaded_sample_count = 4;
+
+  DynamicPlacement(PlacementPolicy placement_policy = PlacementPolicy::RANDOM);
+
+  template<typename Workers>
+  std::size_t select(const Workers& workers);
+ private:
+  PlacementPolicy placement_policy;
+};
+
+std::mt19937& RandomPlacement::engine() {
+  thread_local std::mt19937 thread_engine(std::random_device{}());
+  return thread_engine;
+}
+
+template<typename Workers>
+std::size_t RandomPlacement::select(const Workers& workers) {
+  return selectRandom(workers);
+}
+
+template<typename Workers>
+std::size_t RandomPlacement::selectRandom(const Workers& workers) {
+  return std::uniform_int_distribution<std::size_t>(0, workers.size() - 1)(engine());
+}
+
+template<typename Workers>
+std::size_t RandomPlacement::selectPowerOfTwoChoices(const Workers& workers) {
+  if (workers.size() == 1) {
+    return 0;
+  }
+
+  const auto first = selectRandom(workers);
+  const auto offset = std::uniform_int_distribution<std::size_t>(1, workers.size() - 1)(engine());
+  const auto second = (first + offset) % workers.size();
+  return workers[second].load() < workers[first].load() ? second : first;
+}
+
+template<typename Workers>
+std::size_t RandomPlacement::selectLeastLoaded(const Workers& workers, std::size_t sample_count) {
+  auto best_index = selectRandom(workers);
+  auto best_load = workers[best_index].load();
+  for (auto i = 1; i < sample_count && best_load > 0; ++i) {
+    const auto index = selectRandom(workers);
+    const auto load = workers[index].load();
+    if (load < best_load) {
+      best_index = index;
+      best_load = load;
+    }
+  }
+  return best_index;
+}
+
+template<typename Workers>
+std::size_t PowerOfTwoChoicesPlacement::select(const Workers& workers) {
+  return selectPowerOfTwoChoices(workers);
+}
+
+template<std::size_t SampleCount>
+template<typename Workers>
+std::size_t LeastLoadedPlacement<SampleCount>::select(const Workers& workers) {
+  return selectLeastLoaded(workers, SampleCount);
+}
+
+DynamicPlacement::DynamicPlacement(PlacementPolicy placement_policy) : placement_policy(placement_policy) {
+}
+
+template<typename Workers>
+std::size_t DynamicPlacement::select(const Workers& workers) {
+  switch (placement_policy) {
+    case PlacementPolicy::POWER_OF_TWO_CHOICES:
+      return selectPowerOfTwoChoices(workers);
+    case PlacementPolicy::LEAST_LOADED_OF_K:
+      return selectLeastLoaded(workers, least_loaded_sample_count);
+    default:
+      return selectRandom(workers);
+  }
+}
+
+#endif //TP__PLACEMENT_POLICY_H_
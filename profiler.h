@@ -48,6 +48,8 @@ class Profiler {
   void logWait(Duration);
   void logTask(Duration);
 
+  std::size_t completedTasksCount() const;
+
   friend std::ostream& operator<<(std::ostream& os, const Profiler& profiler);
  private:
   std::unordered_map<std::thread::id, ThreadInfo> thread_info_map;
@@ -106,4 +108,13 @@ void Profiler::logTask(Duration duration) {
   thread_info.completed_tasks_count += 1;
 }
 
+std::size_t Profiler::completedTasksCount() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::size_t count = 0;
+  for (auto& p: thread_info_map) {
+    count += p.second.completed_tasks_count;
+  }
+  return count;
+}
+
 #endif //TP__PROFILER_H_
@@ -0,0 +1,367 @@
+#ifndef TP__REACTOR_H_
+#define TP__REACTOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// An epoll based reactor (Linux only) that lets tasks wait for I/O without holding a worker.
+// A task submits a read, write or timeout together with a continuation and returns; once the
+// operation completes the continuation is handed to the dispatch callback, which queues it on
+// the pool. Operations on one descriptor and direction complete in submission order.
+//
+// Readiness is collected by a dedicated poller thread blocked in epoll_wait and, opportunistically,
+// by idle workers through poll() before they park. Descriptors are switched to non-blocking mode
+// on first use. Regular files are always ready, so their operations complete on submission.
+//
+// An operation only ends by completing. epoll forgets a descriptor once it is closed, so an
+// operation left pending on a closed descriptor would never complete: cancel() a descriptor's
+// operations before closing it, and likewise when its peer may never answer.
+class Reactor {
+ public:
+  // Bytes transferred, 0 at end of file, or a negated errno value.
+  using Completion = std::function<void(long)>;
+  using DispatchCallback = std::function<void(std::function<void()>)>;
+  using PendingCountChangedCallback = std::function<void(int)>;
+
+  Reactor(DispatchCallback, PendingCountChangedCallback);
+  ~Reactor();
+
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+
+  void asyncRead(int fd, void* buffer, std::size_t size, Completion completion);
+  void asyncWrite(int fd, const void* buffer, std::size_t size, Completion completion);
+  void asyncTimeout(std::chrono::nanoseconds duration, std::function<void()> completion);
+
+  // Completes the reads and writes pending on fd with -ECANCELED and stops watching fd.
+  // Returns the number of operations cancelled.
+  std::size_t cancel(int fd);
+
+  // Dispatches the completions that are ready right now, without blocking.
+  // Returns whether any operation completed.
+  bool poll();
+
+  // Stops the poller thread. Operations still pending are dropped without being completed.
+  void stop();
+ private:
+  enum class OperationKind {
+    READ, WRITE, TIMEOUT
+  };
+
+  struct Operation {
+    OperationKind kind;
+    int fd;
+    void* buffer;
+    std::size_t size;
+    Completion completion;
+  };
+
+  struct PendingOperations {
+    std::deque<Operation> reads;
+    std::deque<Operation> writes;
+  };
+
+  static constexpr int max_events_count = 64;
+
+  void submit(Operation operation);
+  // Performs the operation's system call; returns false if the descriptor is not ready yet.
+  bool tryPerform(Operation& operation, long& result);
+  void complete(Operation operation, long result);
+  // Completes the ready operations at the front of the queue; returns whether any completed.
+  bool drain(std::deque<Operation>& operations);
+  // Returns false with errno set if the descriptor cannot be watched.
+  bool arm(int fd, const PendingOperations& pending);
+
+  bool handleEvents(const epoll_event* events, int events_count);
+  void pollerFunction();
+
+  DispatchCallback dispatch_callback;
+  PendingCountChangedCallback pending_count_changed_callback;
+
+  int epoll_fd;
+  int wake_fd;
+
+  std::mutex mutex;
+  std::unordered_map<int, PendingOperations> pending_operations;
+  std::unordered_set<int> registered_fds;
+
+  std::atomic_bool stopped;
+  std::thread poller;
+};
+
+Reactor::Reactor(DispatchCallback dispatch_callback, PendingCountChangedCallback on_pending_count_changed)
+    : dispatch_callback(std::move(dispatch_callback)),
+      pending_count_changed_callback(std::move(on_pending_count_changed)),
+      epoll_fd(-1),
+      wake_fd(-1),
+      stopped(false) {
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "epoll_create1");
+  }
+
+  wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = wake_fd;
+  if (wake_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event) < 0) {
+    const auto error = errno;
+    if (wake_fd >= 0) {
+      close(wake_fd);
+    }
+    close(epoll_fd);
+    throw std::system_error(error, std::generic_category(), "eventfd");
+  }
+
+  poller = std::thread(&Reactor::pollerFunction, this);
+}
+
+Reactor::~Reactor() {
+  stop();
+
+  for (auto& p : pending_operations) {
+    for (auto& operation : p.second.reads) {
+      if (operation.kind == OperationKind::TIMEOUT) {
+        close(operation.fd);
+      }
+    }
+  }
+  close(wake_fd);
+  close(epoll_fd);
+}
+
+void Reactor::asyncRead(int fd, void* buffer, std::size_t size, Completion completion) {
+  submit(Operation{OperationKind::READ, fd, buffer, size, std::move(completion)});
+}
+
+void Reactor::asyncWrite(int fd, const void* buffer, std::size_t size, Completion completion) {
+  submit(Operation{OperationKind::WRITE, fd, const_cast<void*>(buffer), size, std::move(completion)});
+}
+
+void Reactor::asyncTimeout(std::chrono::nanoseconds duration, std::function<void()> completion) {
+  const auto timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer_fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "timerfd_create");
+  }
+
+  // A zero it_value would disarm the timer, so round up to the smallest representable delay.
+  const auto nanoseconds = std::max<std::chrono::nanoseconds::rep>(duration.count(), 1);
+  itimerspec spec{};
+  spec.it_value.tv_sec = nanoseconds / 1000000000;
+  spec.it_value.tv_nsec = nanoseconds % 1000000000;
+  timerfd_settime(timer_fd, 0, &spec, nullptr);
+
+  submit(Operation{OperationKind::TIMEOUT, timer_fd, nullptr, 0, [completion = std::move(completion)](long) {
+    completion();
+  }});
+}
+
+std::size_t Reactor::cancel(int fd) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (registered_fds.erase(fd) != 0) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  }
+
+  const auto it = pending_operations.find(fd);
+  if (it == pending_operations.end()) {
+    return 0;
+  }
+
+  auto pending = std::move(it->second);
+  pending_operations.erase(it);
+  const auto cancelled_count = pending.reads.size() + pending.writes.size();
+  for (auto* operations : {&pending.reads, &pending.writes}) {
+    for (auto& operation : *operations) {
+      complete(std::move(operation), -ECANCELED);
+    }
+  }
+  return cancelled_count;
+}
+
+bool Reactor::poll() {
+  if (stopped) {
+    return false;
+  }
+
+  epoll_event events[max_events_count];
+  const auto events_count = epoll_wait(epoll_fd, events, max_events_count, 0);
+  return events_count > 0 && handleEvents(events, events_count);
+}
+
+void Reactor::stop() {
+  if (stopped.exchange(true)) {
+    return;
+  }
+
+  const std::uint64_t value = 1;
+  [[maybe_unused]] const auto written = write(wake_fd, &value, sizeof(value));
+  if (poller.joinable()) {
+    poller.join();
+  }
+}
+
+void Reactor::submit(Operation operation) {
+  pending_count_changed_callback(1);
+
+  if (operation.kind != OperationKind::TIMEOUT) {
+    const auto flags = fcntl(operation.fd, F_GETFL);
+    if (flags >= 0 && (flags & O_NONBLOCK) == 0) {
+      fcntl(operation.fd, F_SETFL, flags | O_NONBLOCK);
+    }
+  }
+
+  const auto fd = operation.fd;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& pending = pending_operations[fd];
+  auto& queue = operation.kind == OperationKind::WRITE ? pending.writes : pending.reads;
+
+  long result = 0;
+  if (queue.empty() && tryPerform(operation, result)) {
+    complete(std::move(operation), result);
+    if (pending.reads.empty() && pending.writes.empty()) {
+      pending_operations.erase(fd);
+    }
+    return;
+  }
+
+  queue.push_back(std::move(operation));
+  if (!arm(fd, pending)) {
+    result = -errno;
+    auto failed_operation = std::move(queue.back());
+    queue.pop_back();
+    complete(std::move(failed_operation), result);
+    if (pending.reads.empty() && pending.writes.empty()) {
+      pending_operations.erase(fd);
+    }
+  }
+}
+
+bool Reactor::tryPerform(Operation& operation, long& result) {
+  while (true) {
+    long transferred;
+    if (operation.kind == OperationKind::READ) {
+      transferred = read(operation.fd, operation.buffer, operation.size);
+    } else if (operation.kind == OperationKind::WRITE) {
+      transferred = write(operation.fd, operation.buffer, operation.size);
+    } else {
+      std::uint64_t expirations;
+      transferred = read(operation.fd, &expirations, sizeof(expirations));
+    }
+
+    if (transferred >= 0) {
+      result = operation.kind == OperationKind::TIMEOUT ? 0 : transferred;
+      return true;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return false;
+    }
+    if (errno != EINTR) {
+      result = -errno;
+      return true;
+    }
+  }
+}
+
+void Reactor::complete(Operation operation, long result) {
+  if (operation.kind == OperationKind::TIMEOUT) {
+    registered_fds.erase(operation.fd);
+    close(operation.fd);
+  }
+
+  // Dispatch before releasing the pending count so that the pool never observes zero work in between.
+  dispatch_callback([completion = std::move(operation.completion), result] { completion(result); });
+  pending_count_changed_callback(-1);
+}
+
+bool Reactor::drain(std::deque<Operation>& operations) {
+  auto completed = false;
+  long result = 0;
+  while (!operations.empty() && tryPerform(operations.front(), result)) {
+    auto operation = std::move(operations.front());
+    operations.pop_front();
+    complete(std::move(operation), result);
+    completed = true;
+  }
+  return completed;
+}
+
+bool Reactor::arm(int fd, const PendingOperations& pending) {
+  epoll_event event{};
+  std::uint32_t events = EPOLLONESHOT;
+  if (!pending.reads.empty()) {
+    events |= EPOLLIN;
+  }
+  if (!pending.writes.empty()) {
+    events |= EPOLLOUT;
+  }
+  event.events = events;
+  event.data.fd = fd;
+
+  // The kernel forgets a registration when the descriptor is closed, so fall back to adding it again.
+  if (registered_fds.count(fd) != 0 && epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0) {
+    return true;
+  }
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0 ||
+      (errno == EEXIST && epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0)) {
+    registered_fds.insert(fd);
+    return true;
+  }
+  return false;
+}
+
+bool Reactor::handleEvents(const epoll_event* events, int events_count) {
+  auto completed = false;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto i = 0; i < events_count; ++i) {
+    const auto fd = events[i].data.fd;
+    if (fd == wake_fd) {
+      continue;
+    }
+
+    const auto it = pending_operations.find(fd);
+    if (it == pending_operations.end()) {
+      continue;
+    }
+
+    auto& pending = it->second;
+    completed = drain(pending.reads) || completed;
+    completed = drain(pending.writes) || completed;
+
+    if (pending.reads.empty() && pending.writes.empty()) {
+      pending_operations.erase(it);
+    } else {
+      arm(fd, pending);
+    }
+  }
+  return completed;
+}
+
+void Reactor::pollerFunction() {
+  epoll_event events[max_events_count];
+  while (!stopped) {
+    const auto events_count = epoll_wait(epoll_fd, events, max_events_count, -1);
+    if (events_count > 0 && !stopped) {
+      handleEvents(events, events_count);
+    }
+  }
+}
+
+#endif //TP__REACTOR_H_
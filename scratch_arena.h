@@ -0,0 +1,136 @@
+#ifndef TP__SCRATCH_ARENA_H_
+#define TP__SCRATCH_ARENA_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A bump allocator for short-lived task buffers. Allocation moves a pointer inside a retained block,
+// deallocation is a no-op and reset() makes all blocks reusable at once. Every worker owns one that
+// is reset after each task; use a Scope to release memory earlier inside a long task.
+class ScratchArena {
+ public:
+  static constexpr std::size_t default_block_size = 64 * 1024;
+
+  // Restores the arena to the position it had when the scope was created.
+  class Scope {
+   public:
+    explicit Scope(ScratchArena& arena);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+   private:
+    ScratchArena& arena;
+    std::size_t block_index;
+    std::size_t offset;
+  };
+
+  explicit ScratchArena(std::size_t block_size = default_block_size);
+
+  ScratchArena(const ScratchArena&) = delete;
+  ScratchArena& operator=(const ScratchArena&) = delete;
+
+  ScratchArena(ScratchArena&&) = default;
+  ScratchArena& operator=(ScratchArena&&) = default;
+
+  void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+  // Uninitialized storage for count objects of type T.
+  template<typename T>
+  T* allocateArray(std::size_t count);
+
+  void reset();
+ private:
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    std::size_t size;
+  };
+
+  void* tryAllocate(std::size_t size, std::size_t alignment);
+
+  std::vector<Block> blocks;
+  std::size_t block_index;
+  std::size_t offset;
+  std::size_t block_size;
+};
+
+// Lets standard containers allocate from a ScratchArena.
+template<typename T>
+class ScratchAllocator {
+ public:
+  using value_type = T;
+
+  explicit ScratchAllocator(ScratchArena& arena) : arena(&arena) {}
+
+  template<typename U>
+  ScratchAllocator(const ScratchAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(std::size_t count) { return arena->allocateArray<T>(count); }
+  void deallocate(T*, std::size_t) {}
+
+  template<typename U>
+  bool operator==(const ScratchAllocator<U>& other) const { return arena == other.arena; }
+ private:
+  template<typename U>
+  friend class ScratchAllocator;
+
+  ScratchArena* arena;
+};
+
+ScratchArena::Scope::Scope(ScratchArena& arena)
+    : arena(arena), block_index(arena.block_index), offset(arena.offset) {
+}
+
+ScratchArena::Scope::~Scope() {
+  arena.block_index = block_index;
+  arena.offset = offset;
+}
+
+ScratchArena::ScratchArena(std::size_t block_size) : block_index(0), offset(0), block_size(block_size) {
+  assert(block_size > 0 && "The supplied block size cannot be 0");
+}
+
+void* ScratchArena::allocate(std::size_t size, std::size_t alignment) {
+  assert((alignment & (alignment - 1)) == 0 && "The supplied alignment must be a power of two");
+
+  while (block_index < blocks.size()) {
+    if (auto* memory = tryAllocate(size, alignment)) {
+      return memory;
+    }
+    ++block_index;
+    offset = 0;
+  }
+
+  const auto new_block_size = std::max(block_size, size + alignment);
+  blocks.push_back(Block{std::make_unique<std::byte[]>(new_block_size), new_block_size});
+  block_index = blocks.size() - 1;
+  offset = 0;
+  return tryAllocate(size, alignment);
+}
+
+template<typename T>
+T* ScratchArena::allocateArray(std::size_t count) {
+  return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+}
+
+void ScratchArena::reset() {
+  block_index = 0;
+  offset = 0;
+}
+
+void* ScratchArena::tryAllocate(std::size_t size, std::size_t alignment) {
+  auto& block = blocks[block_index];
+  const auto base = reinterpret_cast<std::uintptr_t>(block.data.get());
+  const auto aligned = (base + offset + alignment - 1) & ~(alignment - 1);
+  if (aligned - base + size > block.size) {
+    return nullptr;
+  }
+  offset = aligned - base + size;
+  return reinterpret_cast<void*>(aligned);
+}
+
+#endif //TP__SCRATCH_ARENA_H_
@@ -3,21 +3,15 @@
 
 #include <mutex>
 #include <deque>
+#include <atomic>
 #include <condition_variable>
 
-#ifndef NDEBUG
-#include "profiler.h"
-#include "profiled_mutex.h"
-#endif
+#include "instrumentation_policy.h"
 
-template<typename T>
+template<typename T, typename Instrumentation = DefaultInstrumentation>
 class StealingQueue {
  public:
-  StealingQueue() = default;
-
-#ifndef NDEBUG
-  explicit StealingQueue(const std::shared_ptr<Profiler>&);
-#endif
+  explicit StealingQueue(const Instrumentation& instrumentation = Instrumentation());
 
   StealingQueue(const StealingQueue&) = delete;
   StealingQueue& operator=(const StealingQueue&) = delete;
@@ -28,48 +22,44 @@ class StealingQueue {
   void push(T val);
 
   bool empty() const;
+  std::size_t approximateSize() const;
 
   template<typename WaitPred, typename PopPred>
   bool waitAndPopIf(T& val, const WaitPred&, const PopPred&);
   bool tryPop(T& val);
   bool trySteal(T& val);
 
-  void clear();
+  // Returns the number of elements dropped.
+  std::size_t clear();
 
   void notify();
  private:
-#ifndef NDEBUG
-  using MutexType = ProfiledMutex;
-  using CondVarType = std::condition_variable_any;
-
-  std::shared_ptr<Profiler> profiler;
-#else
-  using MutexType = std::mutex;
-  using CondVarType = std::condition_variable;
-#endif
+  using MutexType = typename Instrumentation::MutexType;
+  using CondVarType = typename Instrumentation::CondVarType;
 
+  [[no_unique_address]] Instrumentation instrumentation;
   mutable MutexType mutex;
   std::deque<T> deque;
+  std::atomic_size_t approximate_size{0};
   CondVarType event;
 };
 
-#ifndef NDEBUG
-template<typename T>
-StealingQueue<T>::StealingQueue(const std::shared_ptr<Profiler>& profiler_ptr): profiler(profiler_ptr), mutex(profiler_ptr) {
+template<typename T, typename Instrumentation>
+StealingQueue<T, Instrumentation>::StealingQueue(const Instrumentation& instrumentation)
+    : instrumentation(instrumentation), mutex(instrumentation.createMutex()) {
 }
-#endif
 
-template<typename T>
-StealingQueue<T>::StealingQueue(StealingQueue&& other) {
+template<typename T, typename Instrumentation>
+StealingQueue<T, Instrumentation>::StealingQueue(StealingQueue&& other)
+    : instrumentation(other.instrumentation), mutex(other.instrumentation.createMutex()) {
   std::lock_guard<MutexType> lock(other.mutex);
   deque = std::move(other.deque);
-#ifndef NDEBUG
-  profiler = std::move(other.profiler);
-#endif
+  approximate_size.store(deque.size(), std::memory_order_relaxed);
+  other.approximate_size.store(0, std::memory_order_relaxed);
 }
 
-template<typename T>
-StealingQueue<T>& StealingQueue<T>::operator=(StealingQueue&& other) {
+template<typename T, typename Instrumentation>
+StealingQueue<T, Instrumentation>& StealingQueue<T, Instrumentation>::operator=(StealingQueue&& other) {
   if (this == &other) {
     return *this;
   }
@@ -79,84 +69,88 @@ StealingQueue<T>& StealingQueue<T>::operator=(StealingQueue&& other) {
     std::lock_guard<MutexType> this_lock(mutex, std::adopt_lock);
     std::lock_guard<MutexType> other_lock(other.mutex, std::adopt_lock);
     deque = std::move(other.deque);
-#ifndef NDEBUG
-    profiler = std::move(other.profiler);
-#endif
+    approximate_size.store(deque.size(), std::memory_order_relaxed);
+    other.approximate_size.store(0, std::memory_order_relaxed);
   }
   event.notify_all();
   return *this;
 }
 
 
-template<typename T>
-void StealingQueue<T>::push(T val) {
+template<typename T, typename Instrumentation>
+void StealingQueue<T, Instrumentation>::push(T val) {
   {
     std::lock_guard<MutexType> lock(mutex);
     deque.push_front(std::move(val));
+    approximate_size.store(deque.size(), std::memory_order_relaxed);
   }
   event.notify_one();
 }
 
-template<typename T>
-bool StealingQueue<T>::empty() const {
+template<typename T, typename Instrumentation>
+bool StealingQueue<T, Instrumentation>::empty() const {
   std::lock_guard<MutexType> lock(mutex);
   return deque.empty();
 }
 
-template<typename T>
-bool StealingQueue<T>::tryPop(T& val) {
+template<typename T, typename Instrumentation>
+std::size_t StealingQueue<T, Instrumentation>::approximateSize() const {
+  return approximate_size.load(std::memory_order_relaxed);
+}
+
+template<typename T, typename Instrumentation>
+bool StealingQueue<T, Instrumentation>::tryPop(T& val) {
   std::lock_guard<MutexType> lock(mutex);
   if (deque.empty()) {
     return false;
   }
   val = std::move(deque.front());
   deque.pop_front();
+  approximate_size.store(deque.size(), std::memory_order_relaxed);
   return true;
 }
 
-template<typename T>
+template<typename T, typename Instrumentation>
 template<typename WaitPred, typename PopPred>
-bool StealingQueue<T>::waitAndPopIf(T& val, const WaitPred& wait_pred, const PopPred& pop_pred) {
+bool StealingQueue<T, Instrumentation>::waitAndPopIf(T& val, const WaitPred& wait_pred, const PopPred& pop_pred) {
   std::unique_lock<MutexType> lock(mutex);
-#ifndef NDEBUG
-  const auto start = Profiler::Clock::now();
-  event.wait<std::unique_lock<MutexType>>(lock, [this, &wait_pred] { return wait_pred(deque.empty()); });
-  const auto end = Profiler::Clock::now();
-  if (profiler) {
-    profiler->logWait(end - start);
-  }
-#else
+  const auto start = instrumentation.now();
   event.wait(lock, [this, &wait_pred] { return wait_pred(deque.empty()); });
-#endif
+  instrumentation.logWait(start);
 
   if (pop_pred(deque.empty())) {
     val = std::move(deque.front());
     deque.pop_front();
+    approximate_size.store(deque.size(), std::memory_order_relaxed);
     return true;
   }
 
   return false;
 }
 
-template<typename T>
-bool StealingQueue<T>::trySteal(T& val) {
+template<typename T, typename Instrumentation>
+bool StealingQueue<T, Instrumentation>::trySteal(T& val) {
   std::lock_guard<MutexType> lock(mutex);
   if (deque.empty()) {
     return false;
   }
   val = std::move(deque.back());
   deque.pop_back();
+  approximate_size.store(deque.size(), std::memory_order_relaxed);
   return true;
 }
 
-template<typename T>
-void StealingQueue<T>::clear() {
+template<typename T, typename Instrumentation>
+std::size_t StealingQueue<T, Instrumentation>::clear() {
   std::lock_guard<MutexType> lock(mutex);
+  const auto cleared_count = deque.size();
   deque.clear();
+  approximate_size.store(0, std::memory_order_relaxed);
+  return cleared_count;
 }
 
-template<typename T>
-void StealingQueue<T>::notify() {
+template<typename T, typename Instrumentation>
+void StealingQueue<T, Instrumentation>::notify() {
   event.notify_one();
 }
 
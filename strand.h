@@ -0,0 +1,158 @@
+#ifndef TP__STRAND_H_
+#define TP__STRAND_H_
+
+#include <atomic>
+#include <cassert>
+#include <utility>
+#include "thread_pool.h"
+
+// A serial executor on top of a pool: tasks posted to one strand run one at a time in FIFO order,
+// while different strands run in parallel. Pending tasks are kept in an intrusive lock-free
+// multi-producer single-consumer queue and at most one drain task per strand is queued on the pool
+// at any time, guarded by the scheduled flag. A strand owns no thread and no mutex.
+//
+// post() always succeeds and allocates a node per task. The pool's capacity and overflow policy
+// do not apply: the backlog is not part of the pool's queueDepth(), so a strand fed faster than it
+// drains grows without limit. Callers that need backpressure must bound their own posts.
+//
+// A strand must not be destroyed while it still has pending tasks; wait for the pool first.
+template<typename Pool = ThreadPool>
+class Strand {
+ public:
+  using Task = typename Pool::Task;
+
+  // Tasks run by one drain before it is requeued behind the rest of the pool's work.
+  static constexpr std::size_t default_batch_size = 64;
+
+  explicit Strand(Pool& pool, std::size_t batch_size = default_batch_size);
+  ~Strand();
+
+  Strand(const Strand&) = delete;
+  Strand& operator=(const Strand&) = delete;
+
+  void post(Task task);
+ private:
+  struct Node {
+    std::atomic<Node*> next{nullptr};
+    Task task;
+  };
+
+  void push(Node* node);
+  Node* pop();
+  bool pending() const;
+
+  void schedule();
+  void drain();
+
+  Pool& pool;
+  std::size_t batch_size;
+
+  std::atomic<Node*> head;
+  Node* tail;
+  Node stub;
+
+  std::atomic_bool scheduled;
+};
+
+template<typename Pool>
+Strand<Pool>::Strand(Pool& pool, std::size_t batch_size)
+    : pool(pool), batch_size(batch_size), head(&stub), tail(&stub), scheduled(false) {
+  assert(batch_size > 0 && "The supplied batch size cannot be 0");
+}
+
+template<typename Pool>
+Strand<Pool>::~Strand() {
+  assert(!scheduled && "Can't destroy a strand with pending tasks.");
+  while (auto* node = pop()) {
+    delete node;
+  }
+}
+
+template<typename Pool>
+void Strand<Pool>::post(Task task) {
+  push(new Node{nullptr, std::move(task)});
+  if (!scheduled.exchange(true)) {
+    schedule();
+  }
+}
+
+template<typename Pool>
+void Strand<Pool>::push(Node* node) {
+  node->next.store(nullptr, std::memory_order_relaxed);
+  auto* previous = head.exchange(node);
+  previous->next.store(node, std::memory_order_release);
+}
+
+// Only called by the single consumer, i.e. the drain task holding the scheduled flag.
+// Returns nullptr when the queue is empty or a producer has not linked its node yet.
+template<typename Pool>
+typename Strand<Pool>::Node* Strand<Pool>::pop() {
+  auto* current = tail;
+  auto* next = current->next.load(std::memory_order_acquire);
+
+  if (current == &stub) {
+    if (next == nullptr) {
+      return nullptr;
+    }
+    tail = next;
+    current = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+
+  if (next != nullptr) {
+    tail = next;
+    return current;
+  }
+
+  if (current != head.load()) {
+    return nullptr;
+  }
+
+  push(&stub);
+  next = current->next.load(std::memory_order_acquire);
+  if (next != nullptr) {
+    tail = next;
+    return current;
+  }
+
+  return nullptr;
+}
+
+// Only called by the consumer while it holds the scheduled flag.
+template<typename Pool>
+bool Strand<Pool>::pending() const {
+  return tail != &stub || head.load() != &stub;
+}
+
+template<typename Pool>
+void Strand<Pool>::schedule() {
+  pool.enqueue([this] { drain(); }, pool.currentWorkerIndex());
+}
+
+template<typename Pool>
+void Strand<Pool>::drain() {
+  for (auto i = 0; i < batch_size; ++i) {
+    auto* node = pop();
+    if (node == nullptr) {
+      break;
+    }
+    node->task();
+    delete node;
+  }
+
+  if (pending()) {
+    // Still holding the scheduled flag: requeue so that other work gets a turn.
+    schedule();
+    return;
+  }
+
+  scheduled.store(false);
+  // A producer that pushed after pending() but saw the flag still set relies on this check. The flag
+  // is released, so another drain may own tail by now; only head is safe to read. pending() was false,
+  // so tail was the stub and any new node shows up as a head other than the stub.
+  if (head.load() != &stub && !scheduled.exchange(true)) {
+    schedule();
+  }
+}
+
+#endif //TP__STRAND_H_
@@ -9,112 +9,238 @@
 #include <functional>
 #include <random>
 #include <utility>
+#include <span>
+#include <iterator>
+#include <cstdint>
+#include <type_traits>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <memory>
 #include "destruction_policy.h"
+#include "placement_policy.h"
+#include "overflow_policy.h"
+#include "idle_policy.h"
+#include "instrumentation_policy.h"
+#include "affinity_partitioner.h"
+#include "blocked_range.h"
+#include "scratch_arena.h"
+#include "stealing_queue.h"
 #include "worker.h"
-
-class ThreadPool {
- public:
-  using Task = std::function<void()>;
-
-  explicit ThreadPool(std::size_t thread_count = std::thread::hardware_concurrency(),
-                      DestructionPolicy destruction_policy = DestructionPolicy::WAIT_CURRENT);
-
-#ifndef NDEBUG
-  explicit ThreadPool(const std::shared_ptr<Profiler>&,
-                      std::size_t thread_count = std::thread::hardware_concurrency(),
-                      DestructionPolicy destruction_policy = DestructionPolicy::WAIT_CURRENT);
+#ifdef __linux__
+#include "reactor.h"
 #endif
 
-  ~ThreadPool();
-
-  void add(Task task);
+// The pool is configured at compile time through policies:
+//  - TaskType: the callable type stored in the queues,
+//  - Placement: picks the worker for add() (see placement_policy.h),
+//  - Instrumentation: mutex/condition variable types and profiling hooks (see instrumentation_policy.h),
+//  - IdlePolicy: what a worker does when it runs out of tasks (see idle_policy.h),
+//  - Queue: the per-worker queue, instantiated as Queue<TaskType, Instrumentation>.
+template<typename TaskType = std::function<void()>,
+    typename Placement = DynamicPlacement,
+    typename Instrumentation = DefaultInstrumentation,
+    typename IdlePolicy = BlockingIdle,
+    template<typename, typename> class Queue = StealingQueue>
+class BasicThreadPool {
+ public:
+  using Task = TaskType;
+  using WorkerType = Worker<Task, Instrumentation, IdlePolicy, Queue>;
+
+  // Capacity value meaning that add() and tryAdd() never run out of room.
+  static constexpr std::size_t unbounded_capacity = std::numeric_limits<std::size_t>::max();
+
+  explicit BasicThreadPool(std::size_t thread_count = std::thread::hardware_concurrency(),
+                           DestructionPolicy destruction_policy = DestructionPolicy::WAIT_CURRENT,
+                           Placement placement = Placement(),
+                           std::size_t capacity = unbounded_capacity,
+                           OverflowPolicy overflow_policy = OverflowPolicy::BLOCK);
+
+  explicit BasicThreadPool(const Instrumentation&,
+                           std::size_t thread_count = std::thread::hardware_concurrency(),
+                           DestructionPolicy destruction_policy = DestructionPolicy::WAIT_CURRENT,
+                           Placement placement = Placement(),
+                           std::size_t capacity = unbounded_capacity,
+                           OverflowPolicy overflow_policy = OverflowPolicy::BLOCK);
+
+  ~BasicThreadPool();
+
+  // add() and tryAdd() respect the capacity given at construction. The capacity is checked against
+  // queueDepth() without locking, so it may be exceeded by the number of concurrent submitters.
+  // Tasks created internally by forEach, parallelFor and pipelines are never refused.
+  // Strand::post() is not bounded at all: a strand's backlog lives in the strand, outside
+  // queueDepth(), and only its drain task is queued on the pool. Bound strand producers yourself.
+
+  // When the pool is full, applies the overflow policy. Returns false if the task was rejected.
+  // With BLOCK, the caller sleeps until a task finishes and frees room. A worker of the pool never
+  // blocks on its own pool and runs the task itself instead.
+  bool add(Task task);
+  // Queues the task on the worker owning affinity_slot (modulo the worker count).
+  // Other workers may still steal it when that worker falls behind.
+  bool add(Task task, std::size_t affinity_slot);
+  // Waits up to timeout for room, whatever the overflow policy and whether or not the caller is a
+  // worker of the pool, and rejects the task afterwards.
+  template<typename Rep, typename Period>
+  bool add(Task task, const std::chrono::duration<Rep, Period>& timeout);
+  // Rejects the task right away when the pool is full.
+  bool tryAdd(Task task);
   void clearTasks();
-  void waitTasks();
+  // Waits until no task is queued or running. With wait_for_io, also waits for the operations
+  // pending in the reactor and for their continuations; pass false when some of them may never
+  // complete. A WAIT_ALL pool waits for pending operations too, so cancel those first.
+  void waitTasks(bool wait_for_io = true);
+
+  // Tasks queued or running, as used for the capacity check.
+  std::size_t queueDepth() const;
+  // Tasks refused by add() or tryAdd() since construction.
+  std::size_t rejectedCount() const;
+
+  std::size_t workerCount() const;
+  // Index of the calling worker in this pool, or the worker count when the caller is not one of its workers.
+  std::size_t currentWorkerIndex() const;
+
+  // The calling worker's scratch arena, reset after every task. Threads outside the pool get a
+  // thread-local arena that is never reset automatically, so scope their use with ScratchArena::Scope.
+  ScratchArena& scratch();
+
+#ifdef __linux__
+  // The pool's I/O reactor, created on first use and only available on Linux. Continuations of its
+  // operations are queued on the workers and idle workers poll it before parking. waitTasks() also
+  // waits for pending operations, but they take no room from the capacity and are not part of queueDepth().
+  Reactor& reactor();
+#endif
 
   template<typename InputIt, typename UnaryFunction>
   void forEach(InputIt first, InputIt last, UnaryFunction f);
+
+  // Splits [first, last) into one sub-range per worker and routes each sub-range to
+  // the worker that ran it during the previous call with the same partitioner.
+  template<typename InputIt, typename UnaryFunction>
+  void forEach(InputIt first, InputIt last, UnaryFunction f, AffinityPartitioner& partitioner);
+
+  // Hands every task a contiguous std::span block of [first, last) instead of single elements,
+  // so the loop inside f can be vectorized. Block boundaries fall on simd_alignment byte boundaries
+  // whenever the element size allows it.
+  template<typename ContiguousIt, typename ChunkFunction>
+  void forEachChunk(ContiguousIt first, ContiguousIt last, ChunkFunction f);
+
+  // Calls f(block_begin, block_end) for consecutive blocks of [begin, end). Block boundaries are
+  // multiples of alignment away from begin.
+  template<typename RangeFunction>
+  void forEachIndex(std::size_t begin, std::size_t end, RangeFunction f, std::size_t alignment = 16);
+
+  // Recursively splits range (e.g. BlockedRange2D or BlockedRange3D) along its longest dimension
+  // until it is no longer divisible and calls body on every resulting tile.
+  template<typename Range, typename Body>
+  void parallelFor(const Range& range, Body body);
+
+  // Alignment in bytes of the blocks handed out by forEachChunk, wide enough for AVX-512.
+  static constexpr std::size_t simd_alignment = 64;
  private:
+  // Number of blocks forEachChunk and forEachIndex create per worker, leaving room for stealing.
+  static constexpr std::size_t blocks_per_worker = 4;
+
+  // Splits [0, size) into blocks whose inner boundaries are head + k * unit and queues block(begin, end) for each.
+  template<typename BlockFunction>
+  void forEachBlock(std::size_t size, std::size_t head, std::size_t unit, BlockFunction block);
+
+  template<typename>
+  friend class Strand;
+  template<typename, typename>
+  friend class Pipeline;
+
+  using Deadline = std::optional<std::chrono::steady_clock::time_point>;
+
+  // Admits the task according to overflow_policy and queues it on worker_index, or on the worker
+  // chosen by the placement policy when worker_index is out of range.
+  bool submit(Task task, std::size_t worker_index, OverflowPolicy overflow_policy, const Deadline& deadline);
+  bool full() const;
+  // Parks the caller until the pool has room; returns false if the deadline passed first.
+  bool waitForRoom(const Deadline& deadline);
+  // Wakes submitters parked in waitForRoom() after tasks finished or were cleared.
+  void notifySubmitters(bool one);
+
+  // Queue without any capacity check.
+  void enqueue(Task task);
+  void enqueue(Task task, std::size_t worker_index);
+
+  template<typename Range, typename Body>
+  void splitAndRun(Range range, const Body& body);
+
+  // Queues the task on the calling worker so that it is popped next by its owner and stolen last,
+  // or on any worker when the caller does not belong to the pool.
+  void addToCurrentWorker(Task task);
+
   void terminate();
 
-  std::vector<Worker<Task>> workers;
+  std::vector<WorkerType> workers;
   std::atomic_bool terminated;
   std::atomic_bool waiting;
   std::atomic_size_t current_tasks_count;
+  std::atomic_size_t pending_io_count;
+  std::atomic_size_t rejected_tasks_count;
   DestructionPolicy destruction_policy;
+  Placement placement;
+  std::size_t capacity;
+  OverflowPolicy overflow_policy;
 
   std::random_device random_device;
-  std::mt19937 engine;
-  std::uniform_int_distribution<std::size_t> distribution;
 
-#ifndef NDEBUG
-  std::shared_ptr<Profiler> profiler;
+  // Submitters blocked on a full pool sleep here instead of spinning, so that they leave the CPU
+  // to the workers draining the backlog. A finishing task only takes the mutex while someone waits.
+  std::mutex room_mutex;
+  std::condition_variable room_event;
+  std::atomic_size_t blocked_submitters_count{0};
+
+#ifdef __linux__
+  std::once_flag reactor_flag;
+  std::unique_ptr<Reactor> reactor_holder;
+  std::atomic<Reactor*> reactor_ptr{nullptr};
 #endif
 };
 
-ThreadPool::ThreadPool(std::size_t thread_count, DestructionPolicy destruction_policy)
-    : terminated(false),
-      waiting(false),
-      destruction_policy(destruction_policy),
-      current_tasks_count(0),
-      engine(random_device()) {
-  assert(thread_count > 0 && "The supplied thread count value cannot be 0");
-
-  distribution = std::uniform_int_distribution<std::size_t>(0, thread_count - 1);
+using ThreadPool = BasicThreadPool<>;
+using ProfiledThreadPool = BasicThreadPool<std::function<void()>, DynamicPlacement, ProfiledInstrumentation>;
 
-  workers.reserve(thread_count);
-  try {
-    for (auto i = 0; i < thread_count; ++i) {
-      workers.emplace_back(
-          [this](Task& task) {
-            if (workers.empty() || terminated) {
-              return false;
-            }
-
-            auto starting_index = distribution(engine);
-
-            for (auto i = 0; i < workers.size() - 1; ++i) {
-              if (workers[(starting_index + i) % workers.size()].trySteal(task)) {
-                return true;
-              }
-            }
-
-            return false;
-          },
-          [this] (int x){
-            current_tasks_count += x;
-          }
-      );
-    }
-  } catch (...) {
-    terminate();
-    throw;
-  }
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::BasicThreadPool(std::size_t thread_count,
+                                                                                          DestructionPolicy destruction_policy,
+                                                                                          Placement placement,
+                                                                                          std::size_t capacity,
+                                                                                          OverflowPolicy overflow_policy)
+    : BasicThreadPool(Instrumentation(), thread_count, destruction_policy, std::move(placement), capacity, overflow_policy) {
 }
 
-#ifndef NDEBUG
-ThreadPool::ThreadPool(const std::shared_ptr<Profiler>& profiler_ptr,
-                       std::size_t thread_count,
-                       DestructionPolicy destruction_policy)
-    : profiler(profiler_ptr),
-      terminated(false),
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::BasicThreadPool(const Instrumentation& instrumentation,
+                                                                                          std::size_t thread_count,
+                                                                                          DestructionPolicy destruction_policy,
+                                                                                          Placement placement,
+                                                                                          std::size_t capacity,
+                                                                                          OverflowPolicy overflow_policy)
+    : terminated(false),
       waiting(false),
       destruction_policy(destruction_policy),
+      placement(std::move(placement)),
+      capacity(capacity),
+      overflow_policy(overflow_policy),
       current_tasks_count(0),
-      engine(random_device()) {
+      pending_io_count(0),
+      rejected_tasks_count(0) {
   assert(thread_count > 0 && "The supplied thread count value cannot be 0");
-
-  distribution = std::uniform_int_distribution<std::size_t>(0, thread_count - 1);
+  assert(capacity > 0 && "The supplied capacity value cannot be 0");
 
   workers.reserve(thread_count);
   try {
     for (auto i = 0; i < thread_count; ++i) {
       workers.emplace_back(
-          [this](Task& task) {
+          // Each worker owns its steal callback, and with it an engine nobody else touches.
+          [this, engine = std::mt19937(random_device())](Task& task) mutable {
             if (workers.empty() || terminated) {
               return false;
             }
 
-            auto starting_index = distribution(engine);
+            auto starting_index = std::uniform_int_distribution<std::size_t>(0, workers.size() - 1)(engine);
 
             for (auto i = 0; i < workers.size() - 1; ++i) {
               if (workers[(starting_index + i) % workers.size()].trySteal(task)) {
@@ -122,12 +248,22 @@ ThreadPool::ThreadPool(const std::shared_ptr<Profiler>& profiler_ptr,
               }
             }
 
+#ifdef __linux__
+            // Completed I/O is queued on this worker, where the idle policy will find it.
+            if (auto* reactor = reactor_ptr.load(std::memory_order_acquire)) {
+              reactor->poll();
+            }
+#endif
+
             return false;
           },
-          [this] (int x) {
-            current_tasks_count += x;
+          [this] (int x){
+            const auto tasks_count = current_tasks_count += x;
+            if (x < 0 && tasks_count < this->capacity && blocked_submitters_count != 0) {
+              notifySubmitters(x == -1);
+            }
           },
-          profiler_ptr
+          instrumentation
       );
     }
   } catch (...) {
@@ -135,9 +271,9 @@ ThreadPool::ThreadPool(const std::shared_ptr<Profiler>& profiler_ptr,
     throw;
   }
 }
-#endif
 
-ThreadPool::~ThreadPool() {
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::~BasicThreadPool() {
   if (destruction_policy == DestructionPolicy::WAIT_CURRENT) {
     terminate();
   } else if (destruction_policy == DestructionPolicy::WAIT_ALL) {
@@ -146,24 +282,101 @@ ThreadPool::~ThreadPool() {
   }
 }
 
-void ThreadPool::add(ThreadPool::Task task) {
-  workers[distribution(engine)].add(std::move(task));
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+bool BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::add(Task task) {
+  return submit(std::move(task), workers.size(), overflow_policy, std::nullopt);
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+bool BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::add(Task task, std::size_t affinity_slot) {
+  return submit(std::move(task), affinity_slot % workers.size(), overflow_policy, std::nullopt);
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+template<typename Rep, typename Period>
+bool BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::add(Task task, const std::chrono::duration<Rep, Period>& timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+  return submit(std::move(task), workers.size(), OverflowPolicy::BLOCK, deadline);
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+bool BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::tryAdd(Task task) {
+  return submit(std::move(task), workers.size(), OverflowPolicy::REJECT, std::nullopt);
 }
 
-void ThreadPool::clearTasks() {
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::clearTasks() {
   for (auto& worker: workers) {
     worker.clearTasks();
   }
 }
 
-void ThreadPool::waitTasks() {
-  while (current_tasks_count != 0) {
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::waitTasks(bool wait_for_io) {
+  // The reactor queues a continuation before releasing its pending count, so checking the pending
+  // count first cannot miss an operation that is moving from one counter to the other.
+  while ((wait_for_io && pending_io_count != 0) || current_tasks_count != 0) {
     std::this_thread::yield();
   }
 }
 
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+std::size_t BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::queueDepth() const {
+  return current_tasks_count.load(std::memory_order_relaxed);
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+std::size_t BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::rejectedCount() const {
+  return rejected_tasks_count.load(std::memory_order_relaxed);
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+std::size_t BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::workerCount() const {
+  return workers.size();
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+std::size_t BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::currentWorkerIndex() const {
+  const auto* worker = WorkerType::current();
+  const std::less<const WorkerType*> less;
+  if (worker == nullptr || less(worker, workers.data()) || !less(worker, workers.data() + workers.size())) {
+    return workers.size();
+  }
+  return worker - workers.data();
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+ScratchArena& BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::scratch() {
+  const auto worker_index = currentWorkerIndex();
+  if (worker_index < workers.size()) {
+    return workers[worker_index].scratch();
+  }
+
+  thread_local ScratchArena arena;
+  return arena;
+}
+
+#ifdef __linux__
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+Reactor& BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::reactor() {
+  std::call_once(reactor_flag, [this] {
+    reactor_holder = std::make_unique<Reactor>(
+        [this](std::function<void()> continuation) {
+          enqueue(std::move(continuation), currentWorkerIndex());
+        },
+        [this](int x) {
+          pending_io_count += x;
+        }
+    );
+    reactor_ptr.store(reactor_holder.get(), std::memory_order_release);
+  });
+  return *reactor_holder;
+}
+#endif
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
 template<typename InputIt, typename UnaryFunction>
-void ThreadPool::forEach(InputIt first, InputIt last, UnaryFunction f) {
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::forEach(InputIt first, InputIt last, UnaryFunction f) {
   const auto tasks_count = std::distance(first, last);
 
   const auto tasks_per_worker = tasks_count / workers.size();
@@ -177,19 +390,230 @@ void ThreadPool::forEach(InputIt first, InputIt last, UnaryFunction f) {
   const auto remaining_tasks_count = tasks_count % workers.size();
   if (remaining_tasks_count > 0) {
     if (remaining_tasks_count == 1) {
-      add([first, f] { f(*first); });
+      enqueue([first, f] { f(*first); });
     } else {
       const auto half = remaining_tasks_count / 2;
-      add([this, first, half, f] { std::for_each(first, first + half, f); });
+      enqueue([this, first, half, f] { std::for_each(first, first + half, f); });
       std::advance(first, half);
-      add([this, first, last, f] { forEach(first, last, f); });
+      enqueue([this, first, last, f] { forEach(first, last, f); });
+    }
+  }
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+template<typename InputIt, typename UnaryFunction>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::forEach(InputIt first,
+                                                                                       InputIt last,
+                                                                                       UnaryFunction f,
+                                                                                       AffinityPartitioner& partitioner) {
+  const auto tasks_count = std::distance(first, last);
+  if (tasks_count == 0) {
+    return;
+  }
+
+  const auto chunks_count = std::min<std::size_t>(workers.size(), tasks_count);
+  partitioner.resize(chunks_count);
+
+  const auto tasks_per_chunk = tasks_count / chunks_count;
+  const auto remaining_tasks_count = tasks_count % chunks_count;
+  for (auto i = 0; i < chunks_count; ++i) {
+    auto chunk_last = first;
+    std::advance(chunk_last, tasks_per_chunk + (i < remaining_tasks_count ? 1 : 0));
+
+    auto& slot = partitioner.slot(i);
+    enqueue([this, first, chunk_last, f, &slot] {
+      const auto worker_index = currentWorkerIndex();
+      if (worker_index < workers.size()) {
+        slot.store(worker_index, std::memory_order_relaxed);
+      }
+      std::for_each(first, chunk_last, f);
+    }, slot.load(std::memory_order_relaxed) % workers.size());
+
+    first = chunk_last;
+  }
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+template<typename ContiguousIt, typename ChunkFunction>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::forEachChunk(ContiguousIt first,
+                                                                                            ContiguousIt last,
+                                                                                            ChunkFunction f) {
+  using ValueType = std::remove_reference_t<std::iter_reference_t<ContiguousIt>>;
+  constexpr auto value_size = sizeof(ValueType);
+
+  const std::span<ValueType> range(first, last);
+
+  std::size_t head = 0;
+  std::size_t unit = 1;
+  if (value_size < simd_alignment && simd_alignment % value_size == 0) {
+    const auto misalignment = reinterpret_cast<std::uintptr_t>(range.data()) % simd_alignment;
+    if (misalignment % value_size == 0) {
+      unit = simd_alignment / value_size;
+      head = misalignment == 0 ? 0 : (simd_alignment - misalignment) / value_size;
     }
   }
+
+  forEachBlock(range.size(), head, unit, [range, f](std::size_t begin, std::size_t end) {
+    f(range.subspan(begin, end - begin));
+  });
 }
 
-void ThreadPool::terminate() {
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+template<typename RangeFunction>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::forEachIndex(std::size_t begin,
+                                                                                            std::size_t end,
+                                                                                            RangeFunction f,
+                                                                                            std::size_t alignment) {
+  assert(alignment > 0 && "The supplied alignment cannot be 0");
+  if (end <= begin) {
+    return;
+  }
+
+  forEachBlock(end - begin, 0, alignment, [begin, f](std::size_t block_begin, std::size_t block_end) {
+    f(begin + block_begin, begin + block_end);
+  });
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+template<typename BlockFunction>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::forEachBlock(std::size_t size,
+                                                                                            std::size_t head,
+                                                                                            std::size_t unit,
+                                                                                            BlockFunction block) {
+  const auto blocks_count = workers.size() * blocks_per_worker;
+  const auto boundary = [size, head, unit, blocks_count](std::size_t k) -> std::size_t {
+    if (k == blocks_count) {
+      return size;
+    }
+    const auto even = k * size / blocks_count;
+    const auto aligned = even <= head ? head : head + (even - head) / unit * unit;
+    return std::min(aligned, size);
+  };
+
+  auto begin = boundary(0);
+  if (begin > 0) {
+    enqueue([block, begin] { block(0, begin); });
+  }
+  for (auto k = 1; k <= blocks_count; ++k) {
+    const auto end = boundary(k);
+    if (end > begin) {
+      enqueue([block, begin, end] { block(begin, end); });
+      begin = end;
+    }
+  }
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+template<typename Range, typename Body>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::parallelFor(const Range& range, Body body) {
+  if (range.empty()) {
+    return;
+  }
+
+  enqueue([this, range, body] { splitAndRun(range, body); });
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+template<typename Range, typename Body>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::splitAndRun(Range range, const Body& body) {
+  while (range.divisible()) {
+    const Range upper(range.split());
+    addToCurrentWorker([this, upper, body] { splitAndRun(upper, body); });
+  }
+  body(range);
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::addToCurrentWorker(Task task) {
+  enqueue(std::move(task), currentWorkerIndex());
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+bool BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::submit(Task task,
+                                                                                    std::size_t worker_index,
+                                                                                    OverflowPolicy overflow_policy,
+                                                                                    const Deadline& deadline) {
+  if (full()) {
+    // An untimed wait on a worker could wait for itself forever; a timed one gives up at the deadline.
+    if (overflow_policy == OverflowPolicy::CALLER_RUNS ||
+        (overflow_policy == OverflowPolicy::BLOCK && !deadline && currentWorkerIndex() < workers.size())) {
+      task();
+      return true;
+    }
+
+    if (overflow_policy == OverflowPolicy::REJECT) {
+      rejected_tasks_count.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    if (!waitForRoom(deadline)) {
+      rejected_tasks_count.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+
+  enqueue(std::move(task), worker_index);
+  return true;
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+bool BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::full() const {
+  return capacity != unbounded_capacity && current_tasks_count.load(std::memory_order_relaxed) >= capacity;
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+bool BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::waitForRoom(const Deadline& deadline) {
+  std::unique_lock<std::mutex> lock(room_mutex);
+  // Registering and then reading the task count pairs with the workers updating the task count and
+  // then reading blocked_submitters_count. Both sides are sequentially consistent, so at least one
+  // of them sees the other and a task finishing in between cannot be missed.
+  ++blocked_submitters_count;
+  const auto room = [this] { return current_tasks_count.load() < capacity; };
+  auto has_room = true;
+  if (deadline) {
+    has_room = room_event.wait_until(lock, *deadline, room);
+  } else {
+    room_event.wait(lock, room);
+  }
+  --blocked_submitters_count;
+  return has_room;
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::notifySubmitters(bool one) {
+  // Taking the mutex closes the gap between a submitter's last check and its wait.
+  { std::lock_guard<std::mutex> lock(room_mutex); }
+  if (one) {
+    room_event.notify_one();
+  } else {
+    room_event.notify_all();
+  }
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::enqueue(Task task) {
+  workers[placement.select(workers)].add(std::move(task));
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::enqueue(Task task, std::size_t worker_index) {
+  if (worker_index < workers.size()) {
+    workers[worker_index].add(std::move(task));
+  } else {
+    enqueue(std::move(task));
+  }
+}
+
+template<typename TaskType, typename Placement, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void BasicThreadPool<TaskType, Placement, Instrumentation, IdlePolicy, Queue>::terminate() {
   terminated = true;
 
+#ifdef __linux__
+  if (auto* reactor = reactor_ptr.load(std::memory_order_acquire)) {
+    reactor->stop();
+  }
+#endif
+
   for (auto& worker: workers) {
     worker.terminate();
   }
@@ -5,18 +5,20 @@
 #include <functional>
 #include <atomic>
 #include "stealing_queue.h"
-
-template<typename Task>
+#include "idle_policy.h"
+#include "instrumentation_policy.h"
+#include "scratch_arena.h"
+
+template<typename Task,
+    typename Instrumentation = DefaultInstrumentation,
+    typename IdlePolicy = BlockingIdle,
+    template<typename, typename> class Queue = StealingQueue>
 class Worker {
  public:
   using StealCallback = std::function<bool(Task&)>;
   using TaskCountChangedCallback = std::function<void(int)>;
 
-  Worker(StealCallback, TaskCountChangedCallback);
-
-#ifndef NDEBUG
-  Worker(StealCallback, TaskCountChangedCallback, const std::shared_ptr<Profiler>&);
-#endif
+  Worker(StealCallback, TaskCountChangedCallback, const Instrumentation& = Instrumentation());
 
   ~Worker();
 
@@ -29,108 +31,116 @@ class Worker {
   void add(Task task);
   void clearTasks();
   bool trySteal(Task& task);
+  std::size_t load() const;
+  // Only to be used from the worker's own thread; reset after every task.
+  ScratchArena& scratch();
 
   void terminate();
 
+  // The worker whose thread is calling, or nullptr when called from a non-worker thread.
+  static const Worker* current();
+
  private:
   void workerFunction();
 
-  StealingQueue<Task> queue;
+  [[no_unique_address]] Instrumentation instrumentation;
+  [[no_unique_address]] IdlePolicy idle_policy;
+  Queue<Task, Instrumentation> queue;
+  ScratchArena scratch_arena;
   StealCallback steal_callback;
   TaskCountChangedCallback task_count_changed_callback;
   std::atomic_bool terminated;
   std::atomic_bool waiting;
   std::thread thread;
 
-#ifndef NDEBUG
-  std::shared_ptr<Profiler> profiler;
-#endif
+  inline static thread_local const Worker* current_worker = nullptr;
 };
 
-template<typename Task>
-Worker<Task>::Worker(StealCallback steal_callback, TaskCountChangedCallback on_task_count_changed)
-    : terminated(false),
-      waiting(false),
-      steal_callback(std::move(steal_callback)),
-      task_count_changed_callback(std::move(on_task_count_changed)),
-      thread(&Worker::workerFunction, this) {
-}
-
-#ifndef NDEBUG
-template<typename Task>
-Worker<Task>::Worker(StealCallback steal_callback, TaskCountChangedCallback on_task_count_changed, const std::shared_ptr<Profiler>& profiler_ptr)
-    : profiler(profiler_ptr),
-      queue(profiler_ptr),
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+Worker<Task, Instrumentation, IdlePolicy, Queue>::Worker(StealCallback steal_callback,
+                                                         TaskCountChangedCallback on_task_count_changed,
+                                                         const Instrumentation& instrumentation)
+    : instrumentation(instrumentation),
+      queue(instrumentation),
       terminated(false),
       waiting(false),
       steal_callback(std::move(steal_callback)),
       task_count_changed_callback(std::move(on_task_count_changed)),
       thread(&Worker::workerFunction, this) {
 }
-#endif
 
-template<typename Task>
-Worker<Task>::Worker(Worker&& other)
-    : queue(std::move(other.queue)),
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+Worker<Task, Instrumentation, IdlePolicy, Queue>::Worker(Worker&& other)
+    : instrumentation(std::move(other.instrumentation)),
+      idle_policy(std::move(other.idle_policy)),
+      queue(std::move(other.queue)),
+      scratch_arena(std::move(other.scratch_arena)),
       steal_callback(std::move(other.steal_callback)),
       task_count_changed_callback(std::move(other.task_count_changed_callback)),
       terminated(other.terminated.load()),
       waiting(other.waiting.load()),
       thread(std::move(other.thread)) {
-#ifndef NDEBUG
-  profiler = std::move(other.profiler);
-#endif
 }
 
-template<typename Task>
-Worker<Task>::~Worker() {
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+Worker<Task, Instrumentation, IdlePolicy, Queue>::~Worker() {
   terminate();
 }
 
-template<typename Task>
-void Worker<Task>::add(Task task) {
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void Worker<Task, Instrumentation, IdlePolicy, Queue>::add(Task task) {
   task_count_changed_callback(1);
   queue.push(std::move(task));
 }
 
-template<typename Task>
-void Worker<Task>::clearTasks() {
-  queue.clear();
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void Worker<Task, Instrumentation, IdlePolicy, Queue>::clearTasks() {
+  const auto cleared_count = queue.clear();
+  if (cleared_count > 0) {
+    task_count_changed_callback(-static_cast<int>(cleared_count));
+  }
 }
 
-template<typename Task>
-bool Worker<Task>::trySteal(Task& task) {
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+bool Worker<Task, Instrumentation, IdlePolicy, Queue>::trySteal(Task& task) {
   return queue.trySteal(task);
 }
 
-template<typename Task>
-void Worker<Task>::workerFunction() {
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+std::size_t Worker<Task, Instrumentation, IdlePolicy, Queue>::load() const {
+  return queue.approximateSize();
+}
+
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+ScratchArena& Worker<Task, Instrumentation, IdlePolicy, Queue>::scratch() {
+  return scratch_arena;
+}
+
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+const Worker<Task, Instrumentation, IdlePolicy, Queue>* Worker<Task, Instrumentation, IdlePolicy, Queue>::current() {
+  return current_worker;
+}
+
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void Worker<Task, Instrumentation, IdlePolicy, Queue>::workerFunction() {
+  current_worker = this;
+  const auto acquire = [this](Task& task) { return queue.tryPop(task) || steal_callback(task); };
   while (!terminated) {
     Task task;
-    if (queue.tryPop(task) ||
-        steal_callback(task) ||
-        queue.waitAndPopIf(task,
-                           [this](bool empty) { return terminated || !empty; },
-                           [this](bool empty) { return !empty && !terminated; })) {
+    if (acquire(task) || idle_policy.idle(queue, task, terminated, acquire)) {
       if (!terminated) {
-#ifndef NDEBUG
-        const auto start = Profiler::Clock::now();
-#endif
+        const auto start = instrumentation.now();
         task();
+        scratch_arena.reset();
         task_count_changed_callback(-1);
-#ifndef NDEBUG
-        const auto end = Profiler::Clock::now();
-        if (profiler) {
-          profiler->logTask(end - start);
-        }
-#endif
+        instrumentation.logTask(start);
       }
     }
   }
 }
 
-template<typename Task>
-void Worker<Task>::terminate() {
+template<typename Task, typename Instrumentation, typename IdlePolicy, template<typename, typename> class Queue>
+void Worker<Task, Instrumentation, IdlePolicy, Queue>::terminate() {
   terminated = true;
   queue.notify();
   if (thread.joinable()) {